@@ -1,7 +1,15 @@
 #include "persistent_file_queue/persistent_queue.h"
 #include <benchmark/benchmark.h>
+#include <spdlog/spdlog.h>
+#include <atomic>
 #include <random>
 #include <filesystem>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 namespace fs = std::filesystem;
 
@@ -102,6 +110,69 @@ static void BM_BatchOperations(benchmark::State& state) {
     }
 }
 
+#ifdef __linux__
+// 把当前线程绑定到指定 CPU，使两端的缓存行交换发生在固定的两个核心之间
+bool PinCurrentThread(size_t cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+// 基准测试：绑定在两个 CPU 上的线程通过一对纯内存队列往返传递 32 字节的记录，统计往返延迟。
+// 参数为记录对齐（0 为格式默认对齐，64/128 为缓存行对齐）和在途记录数；在途记录数大于 1 时，
+// 生产者写入新记录的同时消费者在读取相邻的记录，不对齐时两者会落在同一缓存行上
+static void BM_PingPong(benchmark::State& state) {
+    const size_t alignment = state.range(0);
+    const size_t depth = state.range(1);
+    if (std::thread::hardware_concurrency() < 2) {
+        state.SkipWithError("Requires at least 2 CPUs");
+        return;
+    }
+
+    persistent_file_queue::QueueOptions options;
+    options.storage_dir = (fs::temp_directory_path() / "benchmark_pingpong").string();
+    options.log_dir = (fs::temp_directory_path() / "benchmark_pingpong_logs").string();
+    options.block_size = 1024 * 1024;
+    options.memory_only = true;
+    options.record_alignment = alignment;
+    persistent_file_queue::PersistentQueue requests("ping", options);
+    persistent_file_queue::PersistentQueue replies("pong", options);
+    // 队列默认记录 debug 级日志，往返只有微秒级，日志写入会淹没对齐带来的差异
+    spdlog::get("persistent_queue")->set_level(spdlog::level::warn);
+    const auto data = GenerateRandomData(32);
+
+    std::atomic<bool> stop{false};
+    std::thread echo([&] {
+        PinCurrentThread(1);
+        while (!stop.load(std::memory_order_relaxed)) {
+            if (auto record = requests.Dequeue()) {
+                replies.Enqueue(*record);
+            }
+        }
+    });
+    if (!PinCurrentThread(0)) {
+        state.SkipWithError("Failed to pin thread");
+    }
+
+    for (size_t i = 1; i < depth; ++i) {
+        requests.Enqueue(data);
+    }
+    for (auto _ : state) {
+        requests.Enqueue(data);
+        std::optional<std::vector<std::byte>> reply;
+        while (!(reply = replies.Dequeue())) {
+        }
+        benchmark::DoNotOptimize(reply);
+    }
+
+    stop = true;
+    echo.join();
+    fs::remove_all(options.storage_dir);
+    fs::remove_all(options.log_dir);
+}
+#endif
+
 // 注册基准测试
 BENCHMARK(BM_Enqueue)
     ->Arg(64)      // 64字节
@@ -124,4 +195,15 @@ BENCHMARK(BM_BatchOperations)
     ->Args({1048576, 10})   // 1MB，10次操作
     ->Unit(benchmark::kMillisecond);
 
+#ifdef __linux__
+BENCHMARK(BM_PingPong)
+    ->Args({0, 1})      // 默认对齐，单条往返
+    ->Args({64, 1})     // 64 字节对齐，单条往返
+    ->Args({0, 16})     // 默认对齐，16 条在途
+    ->Args({64, 16})    // 64 字节对齐，16 条在途
+    ->Args({128, 16})   // 128 字节对齐，16 条在途
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
+#endif
+
 BENCHMARK_MAIN(); 
\ No newline at end of file
@@ -22,7 +22,7 @@ class PersistentFileQueueRecipe(ConanFile):
     default_options = {"shared": False, "fPIC": True, "benchmark": False}
 
     # Sources are located in the same place as this recipe, copy them to the recipe
-    exports_sources = "CMakeLists.txt", "src/*", "include/*", "tests/*", "cmake/*"
+    exports_sources = "CMakeLists.txt", "src/*", "include/*", "tests/*", "tools/*", "cmake/*"
 
     def requirements(self):
         self.requires("spdlog/1.15.1")
@@ -0,0 +1,192 @@
+#pragma once
+
+// 协程接口需要 C++20，库本身仍按 C++17 编译，因此本文件只包含头文件实现
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>) && __has_include(<span>)
+
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "persistent_file_queue/persistent_queue.h"
+
+namespace persistent_file_queue {
+
+// 执行器：决定协程在哪个线程上恢复，以及异步入队在哪个线程上执行
+class Executor {
+public:
+    virtual ~Executor() = default;
+
+    // 提交一个任务，任务必须最终被执行
+    virtual void Post(std::function<void()> task) = 0;
+};
+
+// 协程队列：在 PersistentQueue 之上提供可等待的入队和出队操作。
+// 等待出队的协程挂起在等待列表中，不占用线程；新记录提交时由提交线程代为出队并恢复协程，
+// 到期的延迟记录由队列的投递线程代为出队并恢复协程。
+// 构造时会设置队列的数据通知回调，队列同一时间只能关联一个 AsyncQueue；
+// AsyncQueue 必须比所有挂起的协程存活更久
+class AsyncQueue {
+public:
+    // executor 为空时协程在提交记录的线程中恢复，异步入队在调用线程中同步执行
+    explicit AsyncQueue(PersistentQueue& queue, Executor* executor = nullptr)
+        : queue_(queue), executor_(executor) {
+        queue_.SetDataAvailableCallback([this] { OnDataAvailable(); });
+    }
+
+    ~AsyncQueue() {
+        queue_.SetDataAvailableCallback(nullptr);
+    }
+
+    // 禁止拷贝和移动
+    AsyncQueue(const AsyncQueue&) = delete;
+    AsyncQueue& operator=(const AsyncQueue&) = delete;
+    AsyncQueue(AsyncQueue&&) = delete;
+    AsyncQueue& operator=(AsyncQueue&&) = delete;
+
+    class EnqueueAwaiter {
+    public:
+        bool await_ready() const noexcept {
+            return owner_->executor_ == nullptr;
+        }
+
+        void await_suspend(std::coroutine_handle<> handle) {
+            owner_->executor_->Post([this, handle] {
+                Run();
+                handle.resume();
+            });
+        }
+
+        bool await_resume() {
+            if (owner_->executor_ == nullptr) {
+                Run();
+            }
+            if (error_) {
+                std::rethrow_exception(error_);
+            }
+            return result_;
+        }
+
+    private:
+        friend class AsyncQueue;
+        EnqueueAwaiter(AsyncQueue* owner, std::span<const std::byte> data)
+            : owner_(owner), data_(data.begin(), data.end()) {}
+
+        void Run() {
+            try {
+                result_ = owner_->queue_.Enqueue(data_);
+            } catch (...) {
+                error_ = std::current_exception();
+            }
+        }
+
+        AsyncQueue* owner_;
+        std::vector<std::byte> data_;
+        bool result_ = false;
+        std::exception_ptr error_;
+    };
+
+    class DequeueAwaiter {
+    public:
+        bool await_ready() {
+            data_ = owner_->queue_.Dequeue();
+            return data_.has_value();
+        }
+
+        bool await_suspend(std::coroutine_handle<> handle) {
+            handle_ = handle;
+            return owner_->Park(this);
+        }
+
+        std::vector<std::byte> await_resume() {
+            if (error_) {
+                std::rethrow_exception(error_);
+            }
+            return std::move(*data_);
+        }
+
+    private:
+        friend class AsyncQueue;
+        explicit DequeueAwaiter(AsyncQueue* owner) : owner_(owner) {}
+
+        AsyncQueue* owner_;
+        std::coroutine_handle<> handle_;
+        std::optional<std::vector<std::byte>> data_;
+        std::exception_ptr error_;
+    };
+
+    // 异步入队：记录写入并刷盘后恢复，结果与 Enqueue 相同
+    EnqueueAwaiter AsyncEnqueue(std::span<const std::byte> data) {
+        return EnqueueAwaiter(this, data);
+    }
+
+    // 异步出队：队列中有记录时立即返回，否则挂起直到有新记录提交
+    DequeueAwaiter AsyncDequeue() {
+        return DequeueAwaiter(this);
+    }
+
+    // 获取挂起等待出队的协程数量
+    size_t WaitingCount() const {
+        std::scoped_lock lock(waiters_mutex_);
+        return waiters_.size();
+    }
+
+private:
+    // 加入等待列表前在锁内重试出队，避免与通知回调之间丢失唤醒；返回 false 表示无需挂起
+    bool Park(DequeueAwaiter* waiter) {
+        std::scoped_lock lock(waiters_mutex_);
+        waiter->data_ = queue_.Dequeue();
+        if (waiter->data_) {
+            return false;
+        }
+        waiters_.push_back(waiter);
+        return true;
+    }
+
+    // 为等待中的协程依次出队，取到记录的协程在锁外恢复
+    void OnDataAvailable() {
+        std::vector<DequeueAwaiter*> ready;
+        {
+            std::scoped_lock lock(waiters_mutex_);
+            while (!waiters_.empty()) {
+                DequeueAwaiter* waiter = waiters_.front();
+                try {
+                    waiter->data_ = queue_.Dequeue();
+                    if (!waiter->data_) {
+                        break;
+                    }
+                } catch (...) {
+                    waiter->error_ = std::current_exception();
+                }
+                waiters_.pop_front();
+                ready.push_back(waiter);
+            }
+        }
+        for (DequeueAwaiter* waiter : ready) {
+            Resume(waiter->handle_);
+        }
+    }
+
+    void Resume(std::coroutine_handle<> handle) {
+        if (executor_ == nullptr) {
+            handle.resume();
+        } else {
+            executor_->Post([handle] { handle.resume(); });
+        }
+    }
+
+    PersistentQueue& queue_;
+    Executor* executor_;
+    mutable std::mutex waiters_mutex_;
+    std::deque<DequeueAwaiter*> waiters_;  // 挂起等待出队的协程
+};
+
+} // namespace persistent_file_queue
+
+#endif
@@ -1,7 +1,9 @@
 #pragma once
 
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <optional>
@@ -11,21 +13,100 @@
 
 namespace persistent_file_queue {
 
+// 数据损坏回调：参数为损坏记录在文件中的偏移量和错误描述
+using CorruptionCallback = std::function<void(uint64_t offset, std::string_view reason)>;
+
+// 数据损坏处理策略
+enum class CorruptionPolicy {
+    kThrow,       // 抛出异常，读取位置保持不变（默认）
+    kSkip,        // 跳过损坏记录并计数
+    kQuarantine,  // 将损坏记录及其偏移量写入隔离文件后跳过
+};
+
+// 数据损坏统计
+struct CorruptionStats {
+    uint64_t detected = 0;     // 出队时检测到的损坏次数
+    uint64_t skipped = 0;      // 因损坏而跳过的记录数（包括已隔离的）
+    uint64_t quarantined = 0;  // 写入隔离文件的记录数
+};
+
+// 记录大小分布：第 i 个桶统计数据大小在 [2^i, 2^(i+1)) 内的记录数，空记录计入第 0 个桶
+struct RecordSizeStats {
+    static constexpr size_t BUCKETS = 32;  // 记录数据大小小于 2^32
+    uint64_t buckets[BUCKETS] = {};
+};
+
+// 租约模式下收到的记录
+struct LeasedRecord {
+    uint64_t lease_id;            // 租约标识，处理完成后传给 Ack
+    std::vector<std::byte> data;  // 记录数据
+};
+
+// 记录视图：指向队列文件映射中的数据，不拷贝
+struct RecordView {
+    const std::byte* data;
+    size_t size;
+};
+
+// 批量出队回调：视图只在回调执行期间有效，返回 false 时停止，当前记录不出队
+using RecordVisitor = std::function<bool(const RecordView& record)>;
+
+// 幂等入队结果
+enum class EnqueueStatus {
+    kEnqueued,   // 写入成功
+    kDuplicate,  // 序列号不大于该生产者已提交的序列号，记录被丢弃
+    kFull,       // 队列已满
+};
+
+struct QueueOptions;
+
+// 后台巡检配置
+struct ScrubberOptions {
+    size_t bytes_per_second = 64 * 1024 * 1024;      // 巡检速率上限（字节/秒）
+    std::chrono::milliseconds idle_interval{100};    // 没有待巡检数据时的等待间隔
+    CorruptionCallback on_corruption;                // 发现损坏时的回调（在巡检线程中调用）
+};
+
 class PersistentQueue {
 public:
     // 默认配置
     static constexpr const char* DEFAULT_STORAGE_DIR = "storage";  // 默认存储目录
     static constexpr const char* DEFAULT_LOG_DIR = "logs";        // 默认日志目录
     static constexpr size_t DEFAULT_BLOCK_SIZE = 64 * 1024 * 1024; // 64MB
+    static constexpr size_t MAX_PRIORITY_LANES = 8;                // 最大优先级通道数
+    static constexpr size_t MAX_PRODUCERS = 128;                   // 最大幂等生产者数
+    static constexpr uint64_t DEFAULT_FORMAT_VERSION = 1;          // 新建文件默认使用的记录格式版本
+    static constexpr uint64_t LATEST_FORMAT_VERSION = 2;           // 支持的最新记录格式版本
+
+    // 事务：Append 的记录缓存在内存中，CommitTxn 时一起写入并通过一次头部更新同时可见，
+    // 未提交或提交过程中崩溃的事务在恢复后被丢弃
+    class Transaction {
+    public:
+        // 追加一条记录
+        void Append(const std::vector<std::byte>& data);
+
+        // 获取事务中尚未提交的记录数量
+        size_t Size() const;
+
+    private:
+        friend class PersistentQueue;
+        explicit Transaction(size_t priority) : priority_(priority) {}
+
+        size_t priority_;
+        std::vector<std::vector<std::byte>> records_;
+    };
 
     // 构造函数，允许用户配置存储路径和日志路径
     explicit PersistentQueue(
         std::string_view queue_name,                                    // 队列名称
         std::string_view storage_dir = DEFAULT_STORAGE_DIR,            // 存储目录
-        size_t block_size = DEFAULT_BLOCK_SIZE,                        // 块大小
+        size_t block_size = DEFAULT_BLOCK_SIZE,                        // 块大小（仅用于新文件）
         std::string_view log_dir = DEFAULT_LOG_DIR                     // 日志目录
     );
 
+    // 构造函数，使用完整的队列配置
+    PersistentQueue(std::string_view queue_name, const QueueOptions& options);
+
     ~PersistentQueue();
 
     // 禁止拷贝和移动
@@ -34,24 +115,185 @@ public:
     PersistentQueue(PersistentQueue&&) = delete;
     PersistentQueue& operator=(PersistentQueue&&) = delete;
 
-    // 入队操作
+    // 入队操作（写入最低优先级通道 0）
     bool Enqueue(const std::vector<std::byte>& data);
 
-    // 出队操作
+    // 按优先级入队，priority 越大优先级越高，取值范围为 [0, priority_lanes)
+    bool Enqueue(const std::vector<std::byte>& data, size_t priority);
+
+    // 幂等入队：producer_id（非 0）的序列号不大于其已提交的序列号时视为重试，不重复写入。
+    // 各生产者最后提交的序列号保存在文件头部，与记录在同一次头部刷新中持久化。
+    // 头部最多记录 MAX_PRODUCERS 个生产者，表满时新的生产者入队抛出 std::runtime_error，
+    // 不再使用的生产者需通过 RemoveProducer 释放
+    EnqueueStatus EnqueueIdempotent(uint64_t producer_id, uint64_t sequence, const std::vector<std::byte>& data,
+                                    size_t priority = 0);
+
+    // 获取生产者最后提交的序列号，用于重启后恢复生产者状态
+    std::optional<uint64_t> LastSequence(uint64_t producer_id) const;
+
+    // 从生产者表中移除生产者，释放其槽位；之后该生产者的任何序列号都会被当作新记录写入。
+    // 生产者不存在时返回 false
+    bool RemoveProducer(uint64_t producer_id);
+
+    // 开始一个写入指定优先级通道的事务，丢弃事务对象即放弃事务
+    Transaction BeginTxn(size_t priority = 0) const;
+
+    // 提交事务：所有记录要么全部可见，要么全部不可见；空间不足时返回 false，事务保持不变
+    bool CommitTxn(Transaction& txn);
+
+    // 延迟入队：记录先持久化到延迟存储，到达 deliver_after 后才会被 Dequeue/Peek 转入通道 0 并返回。
+    // deliver_after 不晚于当前时间时等同于 Enqueue。到期记录在转入队列与更新延迟存储之间崩溃时可能重复投递。
+    // 投递时间按系统时钟判断：时钟回拨时记录相应推迟投递，向前跳变时提前投递
+    bool EnqueueAt(const std::vector<std::byte>& data, std::chrono::system_clock::time_point deliver_after);
+
+    // 出队操作（多通道时优先取高优先级通道）
     std::optional<std::vector<std::byte>> Dequeue();
 
+    // 批量出队：按 Dequeue 的顺序把最多 max_items 条记录原地交给回调处理，读取位置只在结束时持久化一次；
+    // checkpoint_interval 大于 0 时每处理这么多条记录额外持久化一次。回调返回 false 时停止，该记录不出队；
+    // 回调抛出异常时，之前已处理的记录出队后重新抛出。回调在队列锁内执行，不能调用本队列的方法。
+    // 崩溃后最后一次持久化之后处理过的记录会重新投递。返回出队的记录数
+    size_t ForEach(size_t max_items, const RecordVisitor& visitor, size_t checkpoint_interval = 0);
+
+    // 查看队首数据但不出队
+    std::optional<std::vector<std::byte>> Peek();
+
     // 获取队列中数据项的数量
     size_t Size() const;
 
-    // 获取队列占用的总字节数（包括元数据）
+    // 获取队列占用的总字节数（包括元数据、对齐填充和回绕填充）
     size_t TotalBytes() const;
 
     // 检查队列是否为空
     bool Empty() const;
 
+    // 获取指定优先级通道中数据项的数量
+    size_t LaneSize(size_t priority) const;
+
+    // 获取尚未转入队列的延迟记录数量
+    size_t DelayedSize() const;
+
+    // 租约模式出队：返回记录及租约标识，记录在可见性超时（visibility_timeout）内对其他 Receive 不可见。
+    // 超时未确认的记录会被重新投递；进程重启后所有未确认的记录都会重新投递。
+    // 存在未确认的租约时不能调用 Dequeue/Peek
+    std::optional<LeasedRecord> Receive();
+
+    // 确认租约，读取位置越过所有连续已确认的记录后持久化；
+    // 租约不存在、已确认或记录已被重新投递（超时后迟到的确认）时返回 false
+    bool Ack(uint64_t lease_id);
+
+    // 获取已投递但尚未确认的记录数量
+    size_t LeasedCount() const;
+
+    // 启动后台巡检线程：按速率上限校验未消费记录，出队时跳过已巡检记录的校验
+    void StartScrubber(ScrubberOptions options = {});
+
+    // 停止后台巡检线程
+    void StopScrubber();
+
+    // 获取从读取位置起已巡检通过的字节数
+    size_t ScrubbedBytes() const;
+
+    // 获取数据损坏统计
+    CorruptionStats GetCorruptionStats() const;
+
+    // 获取队列文件创建以来写入记录的大小分布（保存在文件头部，随头部一起持久化）
+    RecordSizeStats GetRecordSizeStats() const;
+
+    // 按记录大小分布推荐块大小：使第 99 百分位大小的记录每块至少能放下 256 条，
+    // 从而把映射和分配的系统调用分摊到足够多的记录上，在此前提下取最小的 2 的幂（64KB 到 DEFAULT_BLOCK_SIZE），
+    // 以减少头部所在块和容量取整浪费的空间。没有记录时返回 DEFAULT_BLOCK_SIZE
+    static size_t RecommendBlockSize(const RecordSizeStats& stats);
+
+    // 获取当前映射的字节数（头部块和所有已映射的数据块）
+    size_t MappedBytes() const;
+
+    // 为后续写入做准备：剩余空间不足一个块且文件可以扩展时扩展文件，并提前映射写入位置之后的块、
+    // 为其分配磁盘空间（Linux）。返回是否做了准备工作。用于在后台线程中完成这些操作，避免阻塞入队
+    bool Preallocate();
+
+    // 压缩单通道队列文件，回收积压消退后的磁盘空间，返回本次释放的字节数。每次调用只做一步有界的工作：
+    // 队列为空时把读写位置移回数据区起始位置；数据全部位于数据区后半部分时提前回绕写入位置，
+    // 使新记录写到文件前部；未回绕且写入位置低于容量一半时把文件截断到写入位置所在的块，之后按需重新扩展。
+    // 记录不会被移动，也不会阻塞生产者；多通道队列和巡检线程运行期间不收缩，
+    // 设置了 shrink_idle_time 时只在队列持续空闲后收缩。开启 adaptive_block_size 时，
+    // 空闲的空队列还会按记录大小分布重新选择块大小。有 QueueReader 打开该队列时跳过收缩和块大小调整
+    size_t Compact();
+
+    // 把队列当前内容导出为一致的快照文件（不支持 Windows），返回快照中的记录数。快照是单个队列文件，
+    // 包含头部和各通道读写位置之间的记录（已投递未确认的记录也包含在内），以 <queue_name>.dat 的名字
+    // 放到存储目录中即可打开；延迟记录不包含在内。只在读取读写位置时持有队列锁，记录在锁外复制
+    // （copy_file_range，支持的文件系统上为 reflink），复制期间记录被覆盖时重新复制。
+    // 先写入 path.tmp，落盘后重命名为 path
+    size_t Snapshot(const std::string& path);
+
+    // 获取可加入 epoll/poll 的 eventfd（仅 Linux）：队列中有记录时可读，队列被取空后不可读。
+    // 只在空与非空状态切换时产生系统调用；描述符由队列拥有，调用方不应读取或关闭它。
+    // 延迟记录到期后由后台投递线程转入队列，描述符随之变为可读
+    int DataAvailableFd();
+
+    // 获取空间释放通知的 eventfd（仅 Linux）：入队因空间不足失败后，有记录被消费时变为可读，
+    // 调用方读取描述符以清除状态后重试入队
+    int SpaceAvailableFd();
+
+    // 设置新记录提交后的通知回调（传入空函数取消）。回调在提交记录的线程中、队列锁之外调用，
+    // 可以在回调中读写队列；多个线程的回调调用互斥执行，本函数返回后旧回调不会再被调用。
+    // 只通知本进程内通过该对象提交的记录；到期的延迟记录在后台投递线程中通知
+    void SetDataAvailableCallback(std::function<void()> callback);
+
 private:
     class Impl;
     std::unique_ptr<Impl> pimpl_;
 };
 
+// 队列配置
+struct QueueOptions {
+    std::string storage_dir = PersistentQueue::DEFAULT_STORAGE_DIR;  // 存储目录
+    // 块大小：只用于创建新文件，打开已有文件时以头部记录的块大小为准（调整见 ReblockQueue）
+    size_t block_size = PersistentQueue::DEFAULT_BLOCK_SIZE;
+    std::string log_dir = PersistentQueue::DEFAULT_LOG_DIR;          // 日志目录
+    CorruptionPolicy corruption_policy = CorruptionPolicy::kThrow;   // 数据损坏处理策略
+    std::string quarantine_path;  // 隔离文件路径，为空时使用 <storage_dir>/<queue_name>.quarantine
+    // 条带目录：非空时数据块按轮询方式分布到 storage_dir 和这些目录中的文件，
+    // 文件名为 <queue_name>.stripe<i>.dat；重新打开时必须使用相同的目录列表
+    std::vector<std::string> stripe_dirs;
+    // 优先级通道数：大于 1 时数据区在创建时按块均分给各通道，每个通道是独立的环形区域，
+    // 共享同一个头部和刷盘流程；重新打开时必须使用相同的通道数
+    size_t priority_lanes = 1;
+    // 高优先级通道连续出队多少次后让等待中的低优先级通道出队一次，0 表示严格按优先级
+    size_t lane_starvation_limit = 0;
+    // 延迟记录按投递时间分桶的时间粒度，每个桶对应 <storage_dir>/<queue_name>.delay 中的一个段文件
+    std::chrono::milliseconds delay_bucket_interval{1000};
+    // 租约模式下记录的可见性超时，超时未确认的记录会被重新投递
+    std::chrono::milliseconds visibility_timeout{30000};
+    // 延迟打开：打开已有文件时只校验头部，不遍历积压记录，记录在出队时校验；
+    // 新建的单通道文件只分配一个数据块，写入时按需扩展到最大大小；数据块在首次访问时映射并预读。
+    // 适合一个进程同时打开大量大多空闲的队列
+    bool lazy_open = false;
+    // 读取位置越过块边界后，在完整消费的块上打洞（FALLOC_FL_PUNCH_HOLE，仅 Linux），
+    // 使已消费数据不再占用磁盘空间；文件大小不变，文件系统不支持时自动关闭
+    bool punch_consumed_blocks = false;
+    // Compact 收缩文件前要求队列持续空闲（头部没有变化）的时间，0 表示不要求；
+    // 空闲时间按 Compact 的调用间隔粗略统计
+    std::chrono::milliseconds shrink_idle_time{0};
+    // 自适应块大小：单通道队列为空且满足收缩的空闲条件时，Compact 按 RecommendBlockSize 重新选择块大小，
+    // 推荐值与当前块大小相差 4 倍以上（且已写入至少 1024 条记录）才调整；文件以两个新块重新开始，之后按需扩展。
+    // 有 QueueReader 打开该队列时不调整
+    bool adaptive_block_size = false;
+    // 直接 I/O（仅 Linux）：记录经对齐的暂存缓冲区以 O_DIRECT | O_DSYNC 写入，不经过页缓存，
+    // 出队越过的块从页缓存中丢弃，适合大记录的流式写入；块大小必须是 4096 的倍数
+    bool direct_io = false;
+    // 纯内存模式（仅 Linux）：数据保存在匿名内存文件（memfd_create）中，不创建队列文件，刷盘为空操作，
+    // 关闭后数据丢失。记录格式、校验和容量限制与持久化队列相同，只需修改配置即可切换；
+    // 延迟记录和隔离文件仍写入 storage_dir。不能与 direct_io 同时使用
+    bool memory_only = false;
+    // 新建文件使用的记录格式版本，0 表示 DEFAULT_FORMAT_VERSION（v1）。v2 使用 4 字节校验和、记录按 8 字节对齐。
+    // 已有文件始终按头部中的版本读写，可用 UpgradeQueue 转换
+    uint64_t format_version = 0;
+    // 新建文件的记录对齐（字节），0 表示使用格式版本自身的对齐（v1 为 1，v2 为 8），否则为不超过 128 的 2 的幂。
+    // 设为缓存行大小（64 或 128）时每条记录从新的缓存行开始，生产者写入下一条记录时不会与正在读取上一条记录的
+    // 消费者竞争同一缓存行；对齐填充计入 TotalBytes()。已有文件始终按头部中的对齐读写
+    size_t record_alignment = 0;
+};
+
 } // namespace persistent_file_queue 
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <string_view>
+
+#include "persistent_file_queue/persistent_queue.h"
+
+namespace persistent_file_queue {
+
+// 队列管理器配置
+struct QueueManagerOptions {
+    QueueOptions queue_options;  // 所有队列共用的配置，队列文件为 <storage_dir>/<queue_name>.dat
+    // 所有打开队列的映射字节数上限，0 表示不限制。超出时关闭最久未访问的空闲队列，
+    // 正在使用的队列不会被关闭，因此上限可能被暂时突破
+    size_t mapped_bytes_budget = 0;
+    // 空闲队列（没有外部句柄）超过该时间未被访问时关闭，0 表示不按时间关闭
+    std::chrono::milliseconds idle_timeout{60000};
+    // 后台维护线程的运行间隔
+    std::chrono::milliseconds maintenance_interval{1000};
+    // 是否由后台线程为各队列提前扩展文件、映射并分配下一个写入块（见 PersistentQueue::Preallocate）
+    bool preallocate = true;
+    // 是否由后台线程压缩各队列文件，积压消退后收缩文件（见 PersistentQueue::Compact）
+    bool compact = true;
+};
+
+// 队列管理器：在一个进程中管理大量队列。队列在首次访问时打开，空闲后关闭；
+// 所有队列共享一个后台维护线程（预分配和压缩文件、关闭空闲队列、控制映射字节数）和同一个日志记录器。
+class QueueManager {
+public:
+    explicit QueueManager(QueueManagerOptions options = {});
+
+    // 停止维护线程并关闭所有队列，调用前应释放所有队列句柄
+    ~QueueManager();
+
+    // 禁止拷贝和移动
+    QueueManager(const QueueManager&) = delete;
+    QueueManager& operator=(const QueueManager&) = delete;
+    QueueManager(QueueManager&&) = delete;
+    QueueManager& operator=(QueueManager&&) = delete;
+
+    // 获取队列句柄，队列未打开时打开或创建它。持有句柄期间队列不会被关闭
+    std::shared_ptr<PersistentQueue> Get(std::string_view queue_name);
+
+    // 立即执行一次维护：预分配文件，关闭超时的空闲队列，并在超出映射预算时关闭空闲队列
+    void RunMaintenance();
+
+    // 获取当前打开的队列数量
+    size_t OpenCount() const;
+
+    // 获取所有打开队列的映射字节数
+    size_t MappedBytes() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pimpl_;
+};
+
+} // namespace persistent_file_queue
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string_view>
+
+#include "persistent_file_queue/persistent_queue.h"
+
+namespace persistent_file_queue {
+
+// 只读队列读取器：以只读方式打开队列文件（PROT_READ，不写头部），
+// 从读取位置到写入位置遍历已提交的记录，不影响队列的消费者，可用于调试、审计和监控。
+// 读取器拥有独立的游标；消费者越过游标时，游标跳到新的读取位置。
+// 读取器打开期间持有队列主文件的共享文件锁，写入方在此期间不会收缩或重建文件（PersistentQueue::Compact）。
+// WaitNext 在队列旁的 .notify 文件中登记等待者，写入方只在有等待者时发出唤醒。
+class QueueReader {
+public:
+    // 构造函数，options 需与写入方的存储目录、块大小和条带目录一致；lane 为要读取的优先级通道
+    explicit QueueReader(std::string_view queue_name, const QueueOptions& options = {}, size_t lane = 0);
+
+    ~QueueReader();
+
+    // 禁止拷贝和移动
+    QueueReader(const QueueReader&) = delete;
+    QueueReader& operator=(const QueueReader&) = delete;
+    QueueReader(QueueReader&&) = delete;
+    QueueReader& operator=(QueueReader&&) = delete;
+
+    // 读取下一条已提交的记录，没有新记录时返回 std::nullopt。
+    // 返回的视图在下一次调用 Next/WaitNext 前有效，且记录被消费后可能被写入方覆盖
+    std::optional<RecordView> Next();
+
+    // 等待下一条记录直到超时，用于跟随写入方读取新提交的记录。
+    // Linux 上通过头部中的通知序号（futex）等待写入方提交，其他平台轮询
+    std::optional<RecordView> WaitNext(std::chrono::milliseconds timeout);
+
+    // 将游标移动到队列当前的读取位置
+    void SeekToHead();
+
+    // 获取队列的优先级通道数（来自文件头部）
+    size_t LaneCount() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pimpl_;
+};
+
+} // namespace persistent_file_queue
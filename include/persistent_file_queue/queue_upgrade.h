@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "persistent_file_queue/persistent_queue.h"
+
+namespace persistent_file_queue {
+
+// 读取队列文件头部中的记录格式版本
+uint64_t QueueFormatVersion(std::string_view queue_name, const QueueOptions& options = {});
+
+// 读取队列文件头部中的块大小
+size_t QueueBlockSize(std::string_view queue_name, const QueueOptions& options = {});
+
+// 把队列文件转换为记录格式 target_version：用只读读取器逐条读取各通道中未消费的记录，
+// 按通道写入新格式的临时队列（<queue_name>.upgrade），幂等生产者表一并迁移，完成后重命名替换原文件。
+// 转换期间不能有进程打开该队列（可先通过 QueueManager 关闭空闲队列）；已投递未确认的租约记录作为未消费记录保留。
+// 块大小和记录对齐保持不变。文件已是目标版本时不做修改。返回迁移的记录数
+size_t UpgradeQueue(std::string_view queue_name, const QueueOptions& options, uint64_t target_version);
+
+// 按新的块大小 block_size（4096 的正整数倍）重写队列文件，记录格式版本不变。
+// 打开已有队列时以文件头部中的块大小为准，调整块大小需要通过本函数离线完成，限制与 UpgradeQueue 相同。
+// 块大小未变化时不做修改。返回迁移的记录数
+size_t ReblockQueue(std::string_view queue_name, const QueueOptions& options, size_t block_size);
+
+} // namespace persistent_file_queue
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "persistent_file_queue/persistent_queue.h"
+
+namespace persistent_file_queue {
+
+// 分片队列：将一个逻辑队列的记录分散到多个 PersistentQueue 上，
+// 每个分片拥有独立的文件、锁和写入位置，可由多个线程并行写入和读取。
+// 每条记录带有全局递增的序列号，可按序列号归并读取。序列号在持有分片写入锁时分配，
+// 因此同一分片内序列号与写入顺序一致。
+class ShardedPersistentQueue {
+public:
+    // 构造函数，分片文件命名为 <queue_name>_shard<i>.dat
+    ShardedPersistentQueue(std::string_view queue_name, size_t shard_count, const QueueOptions& options = {});
+
+    ~ShardedPersistentQueue();
+
+    // 禁止拷贝和移动
+    ShardedPersistentQueue(const ShardedPersistentQueue&) = delete;
+    ShardedPersistentQueue& operator=(const ShardedPersistentQueue&) = delete;
+    ShardedPersistentQueue(ShardedPersistentQueue&&) = delete;
+    ShardedPersistentQueue& operator=(ShardedPersistentQueue&&) = delete;
+
+    // 入队操作：每个生产者线程独立轮询分片，分片已满时尝试下一个分片
+    bool Enqueue(const std::vector<std::byte>& data);
+
+    // 按键入队：相同键的记录写入同一分片，保持相对顺序
+    bool Enqueue(std::string_view key, const std::vector<std::byte>& data);
+
+    // 从指定分片出队，每个消费者线程可以独立读取一个分片
+    std::optional<std::vector<std::byte>> DequeueShard(size_t shard);
+
+    // 按序列号归并出队：返回所有分片当前可见记录中序列号最小的一条。
+    // 只保证按调用时已可见的记录归并：其他分片上正在写入的记录序列号可能更小，
+    // 会在之后返回，即跨分片的全序只在写入结束后成立。
+    // 归并读取会缓存各分片队首的序列号，不应与 DequeueShard 混用。
+    std::optional<std::vector<std::byte>> DequeueOrdered();
+
+    // 获取分片数量
+    size_t ShardCount() const;
+
+    // 获取所有分片中数据项的总数量
+    size_t Size() const;
+
+    // 获取所有分片占用的总字节数（包括元数据和序列号）
+    size_t TotalBytes() const;
+
+    // 检查所有分片是否为空
+    bool Empty() const;
+
+private:
+    // 分片内记录格式：序列号(uint64) + 用户数据
+    uint64_t NextSequence();
+    bool EnqueueToShard(size_t shard, const std::vector<std::byte>& data);
+
+    std::vector<std::unique_ptr<PersistentQueue>> shards_;
+    std::vector<std::mutex> shard_mutexes_;  // 分片写入锁，保证分配序列号与写入分片的顺序一致
+    std::atomic<uint64_t> last_sequence_{0};
+
+    // 归并读取状态
+    std::mutex merge_mutex_;
+    std::vector<std::optional<uint64_t>> merge_heads_;  // 各分片队首记录的序列号
+};
+
+} // namespace persistent_file_queue
@@ -0,0 +1,239 @@
+#include "delayed_record_store.h"
+#include "queue_format.h"
+
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <spdlog/spdlog.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace persistent_file_queue {
+
+namespace {
+
+constexpr const char* SEGMENT_EXTENSION = ".seg";
+constexpr size_t DATA_OFFSET = sizeof(std::byte) + sizeof(int64_t) + sizeof(uint32_t);
+constexpr size_t RECORD_OVERHEAD = DATA_OFFSET + sizeof(std::byte);
+constexpr std::byte STATE_PENDING{0};
+constexpr std::byte STATE_PROMOTED{1};
+
+// 刷新并同步到磁盘后关闭文件
+bool SyncAndClose(std::FILE* file, bool ok) {
+    ok = ok && std::fflush(file) == 0;
+#ifdef _WIN32
+    ok = ok && _commit(_fileno(file)) == 0;
+#else
+    ok = ok && fsync(fileno(file)) == 0;
+#endif
+    return std::fclose(file) == 0 && ok;
+}
+
+bool Seek(std::FILE* file, uint64_t offset) {
+    return std::fseek(file, static_cast<long>(offset), SEEK_SET) == 0;
+}
+
+} // namespace
+
+DelayedRecordStore::DelayedRecordStore(fs::path directory, std::chrono::milliseconds bucket_interval)
+    : directory_(std::move(directory)), bucket_interval_ms_(bucket_interval.count()) {
+    if (bucket_interval_ms_ <= 0) {
+        throw std::invalid_argument("Invalid delay bucket interval");
+    }
+    if (!fs::exists(directory_)) {
+        return;
+    }
+
+    // 恢复各时间桶的待转出记录索引，记录内容在到期时再读取
+    for (const auto& entry : fs::directory_iterator(directory_)) {
+        if (!entry.is_regular_file() || entry.path().extension() != SEGMENT_EXTENSION) {
+            continue;
+        }
+        int64_t bucket_start_ms;
+        try {
+            bucket_start_ms = std::stoll(entry.path().stem().string());
+        } catch (const std::exception&) {
+            spdlog::warn("Ignoring unexpected file in delay directory: {}", entry.path().string());
+            continue;
+        }
+        Bucket bucket;
+        LoadBucket(bucket_start_ms, bucket);
+        if (bucket.pending.empty()) {
+            fs::remove(entry.path());
+            continue;
+        }
+        size_ += bucket.pending.size();
+        buckets_.emplace(bucket_start_ms, std::move(bucket));
+    }
+}
+
+void DelayedRecordStore::Add(int64_t deliver_at_ns, const std::vector<std::byte>& data) {
+    const int64_t deliver_at_ms = deliver_at_ns / 1000000;
+    const int64_t bucket_start_ms = deliver_at_ms - deliver_at_ms % bucket_interval_ms_;
+    const fs::path path = BucketPath(bucket_start_ms);
+
+    if (buckets_.find(bucket_start_ms) == buckets_.end()) {
+        fs::create_directories(directory_);
+    }
+    Bucket& bucket = buckets_[bucket_start_ms];
+    std::FILE* file = std::fopen(path.string().c_str(), "ab");
+    if (file == nullptr) {
+        if (bucket.pending.empty()) {
+            buckets_.erase(bucket_start_ms);
+        }
+        throw std::runtime_error("Failed to open delay segment");
+    }
+    const uint32_t data_size = static_cast<uint32_t>(data.size());
+    const std::byte checksum = CalculateChecksum(data.data(), data.size());
+    const bool ok = std::fwrite(&STATE_PENDING, sizeof(STATE_PENDING), 1, file) == 1 &&
+                    std::fwrite(&deliver_at_ns, sizeof(deliver_at_ns), 1, file) == 1 &&
+                    std::fwrite(&data_size, sizeof(data_size), 1, file) == 1 &&
+                    std::fwrite(data.data(), 1, data.size(), file) == data.size() &&
+                    std::fwrite(&checksum, sizeof(checksum), 1, file) == 1;
+    if (!SyncAndClose(file, ok)) {
+        // 去掉写了一半的记录，保持索引中的偏移与文件一致
+        std::error_code ec;
+        fs::resize_file(path, bucket.file_size, ec);
+        if (bucket.pending.empty()) {
+            buckets_.erase(bucket_start_ms);
+        }
+        throw std::runtime_error("Failed to write delay segment");
+    }
+
+    bucket.pending.insert(Entry{deliver_at_ns, bucket.file_size, data_size});
+    bucket.file_size += RECORD_OVERHEAD + data_size;
+    size_++;
+}
+
+size_t DelayedRecordStore::PromoteDue(int64_t now_ns, const Sink& sink, const std::function<void()>& on_batch_done) {
+    size_t promoted_total = 0;
+    while (HasDue(now_ns)) {
+        const auto it = buckets_.begin();
+        Bucket& bucket = it->second;
+        const fs::path path = BucketPath(it->first);
+        std::FILE* file = std::fopen(path.string().c_str(), "r+b");
+        if (file == nullptr) {
+            throw std::runtime_error("Failed to open delay segment");
+        }
+
+        // 按投递时间从索引中依次取出到期记录，只读取这些记录的数据
+        std::vector<uint64_t> promoted;
+        try {
+            while (!bucket.pending.empty() && bucket.pending.begin()->deliver_at_ns <= now_ns) {
+                const Entry entry = *bucket.pending.begin();
+                std::vector<std::byte> data(entry.data_size);
+                if (!Seek(file, entry.offset + DATA_OFFSET) ||
+                    std::fread(data.data(), 1, data.size(), file) != data.size()) {
+                    throw std::runtime_error("Failed to read delay segment");
+                }
+                if (!sink(data)) {
+                    break;
+                }
+                bucket.pending.erase(bucket.pending.begin());
+                promoted.push_back(entry.offset);
+            }
+        } catch (...) {
+            std::fclose(file);
+            throw;
+        }
+
+        if (!promoted.empty()) {
+            on_batch_done();
+            promoted_total += promoted.size();
+            size_ -= promoted.size();
+        }
+        if (bucket.pending.empty()) {
+            std::fclose(file);
+            fs::remove(path);
+            buckets_.erase(it);
+            continue;
+        }
+        if (promoted.empty()) {
+            std::fclose(file);
+        } else {
+            // 按记录偏移标记已转出，与排序位置无关，之后插入的记录不会被误认为已转出
+            bool ok = true;
+            for (const uint64_t offset : promoted) {
+                ok = ok && Seek(file, offset) && std::fwrite(&STATE_PROMOTED, sizeof(STATE_PROMOTED), 1, file) == 1;
+            }
+            if (!SyncAndClose(file, ok)) {
+                throw std::runtime_error("Failed to write delay segment");
+            }
+        }
+        // 目标队列已满，或最早的桶中剩余记录尚未到期
+        break;
+    }
+    return promoted_total;
+}
+
+bool DelayedRecordStore::HasDue(int64_t now_ns) const {
+    // 时间桶按投递时间划分，最早的记录一定在第一个桶中；空桶会被立即删除
+    return !buckets_.empty() && buckets_.begin()->second.pending.begin()->deliver_at_ns <= now_ns;
+}
+
+std::optional<int64_t> DelayedRecordStore::NextDue() const {
+    if (buckets_.empty()) {
+        return std::nullopt;
+    }
+    return buckets_.begin()->second.pending.begin()->deliver_at_ns;
+}
+
+size_t DelayedRecordStore::Size() const {
+    return size_;
+}
+
+fs::path DelayedRecordStore::BucketPath(int64_t bucket_start_ms) const {
+    return directory_ / (std::to_string(bucket_start_ms) + SEGMENT_EXTENSION);
+}
+
+void DelayedRecordStore::LoadBucket(int64_t bucket_start_ms, Bucket& bucket) const {
+    const fs::path path = BucketPath(bucket_start_ms);
+    std::FILE* file = std::fopen(path.string().c_str(), "rb");
+    if (file == nullptr) {
+        throw std::runtime_error("Failed to open delay segment");
+    }
+
+    uint64_t valid_size = 0;
+    std::vector<std::byte> data;
+    while (true) {
+        std::byte state;
+        int64_t deliver_at_ns;
+        uint32_t data_size;
+        if (std::fread(&state, sizeof(state), 1, file) != 1 ||
+            std::fread(&deliver_at_ns, sizeof(deliver_at_ns), 1, file) != 1 ||
+            std::fread(&data_size, sizeof(data_size), 1, file) != 1) {
+            break;
+        }
+        data.resize(data_size);
+        std::byte checksum;
+        if (std::fread(data.data(), 1, data_size, file) != data_size ||
+            std::fread(&checksum, sizeof(checksum), 1, file) != 1) {
+            break;
+        }
+        if (CalculateChecksum(data.data(), data.size()) != checksum) {
+            spdlog::error("Checksum mismatch in delay segment: {}", path.string());
+            break;
+        }
+        if (state == STATE_PENDING) {
+            bucket.pending.insert(Entry{deliver_at_ns, valid_size, data_size});
+        }
+        valid_size += RECORD_OVERHEAD + data_size;
+    }
+    std::fclose(file);
+    bucket.file_size = valid_size;
+
+    // 截断写入中断留下的残缺记录，保证后续追加的记录可以被正确解析
+    if (fs::file_size(path) != valid_size) {
+        spdlog::warn("Truncating delay segment {} to {} bytes", path.string(), valid_size);
+        fs::resize_file(path, valid_size);
+    }
+}
+
+} // namespace persistent_file_queue
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <optional>
+#include <set>
+#include <vector>
+
+namespace persistent_file_queue {
+
+// 延迟记录存储：按投递时间分桶的段文件，每个时间桶对应目录中的一个文件 <桶起始毫秒>.seg。
+// 段文件由若干条记录组成，每条记录为 状态(1 字节) + 投递时间(int64 纳秒) + 数据大小(uint32) + 数据 + 校验和(1 字节)，
+// 状态为 0 表示待转出，转出后原地改写为 1。
+// 插入只追加到对应时间桶的段文件；打开时扫描一次段文件，在内存中为每个桶维护按投递时间排序的待转出记录索引，
+// 到期时从索引中依次取出并按偏移读取记录，全部转出后删除段文件。
+// 投递时间是系统时钟（持久化后跨重启有效）：时钟回拨时记录相应推迟投递，向前跳变时提前投递
+class DelayedRecordStore {
+public:
+    // 接收到期记录的回调，返回 false 表示目标队列已满，停止转出
+    using Sink = std::function<bool(const std::vector<std::byte>& data)>;
+
+    DelayedRecordStore(std::filesystem::path directory, std::chrono::milliseconds bucket_interval);
+
+    // 追加一条延迟记录，返回前已写入磁盘
+    void Add(int64_t deliver_at_ns, const std::vector<std::byte>& data);
+
+    // 将投递时间不晚于 now_ns 的记录按投递时间顺序交给 sink，返回转出的记录数。
+    // 每个时间桶转出后先调用 on_batch_done（调用方应在其中让已转出的记录落盘），
+    // 再持久化该桶的转出进度；两者之间崩溃会导致记录重复投递
+    size_t PromoteDue(int64_t now_ns, const Sink& sink, const std::function<void()>& on_batch_done);
+
+    // 是否有投递时间不晚于 now_ns 的记录
+    bool HasDue(int64_t now_ns) const;
+
+    // 最早的未转出记录的投递时间，没有延迟记录时返回 std::nullopt
+    std::optional<int64_t> NextDue() const;
+
+    // 尚未转出的延迟记录数量
+    size_t Size() const;
+
+private:
+    // 待转出记录在段文件中的位置，按投递时间排序，投递时间相同时按写入顺序
+    struct Entry {
+        int64_t deliver_at_ns;
+        uint64_t offset;     // 记录在段文件中的偏移
+        uint32_t data_size;
+
+        bool operator<(const Entry& other) const {
+            return deliver_at_ns != other.deliver_at_ns ? deliver_at_ns < other.deliver_at_ns : offset < other.offset;
+        }
+    };
+
+    struct Bucket {
+        std::set<Entry> pending;  // 尚未转出的记录
+        uint64_t file_size = 0;   // 段文件中有效记录的总长度，新记录追加在此处
+    };
+
+    std::filesystem::path BucketPath(int64_t bucket_start_ms) const;
+    // 扫描时间桶的段文件，建立待转出记录的索引；末尾不完整或校验失败的记录会被截断
+    void LoadBucket(int64_t bucket_start_ms, Bucket& bucket) const;
+
+    std::filesystem::path directory_;
+    int64_t bucket_interval_ms_;
+    std::map<int64_t, Bucket> buckets_;  // 桶起始毫秒 -> 桶状态
+    size_t size_ = 0;
+};
+
+} // namespace persistent_file_queue
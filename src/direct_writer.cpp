@@ -0,0 +1,255 @@
+#include "direct_writer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace persistent_file_queue {
+
+namespace {
+
+// 进程内共享的对齐暂存缓冲区池：同一时间每个写入器最多借用一个缓冲区，
+// 大量队列共享少量缓冲区，空闲缓冲区最多保留 MAX_FREE 个
+class StagingBufferPool {
+public:
+    static StagingBufferPool& Instance() {
+        static StagingBufferPool pool;
+        return pool;
+    }
+
+    std::byte* Acquire() {
+        {
+            std::scoped_lock lock(mutex_);
+            if (!free_.empty()) {
+                std::byte* buffer = free_.back();
+                free_.pop_back();
+                return buffer;
+            }
+        }
+        void* buffer = std::aligned_alloc(DirectWriter::ALIGNMENT, DirectWriter::CHUNK_SIZE);
+        if (buffer == nullptr) {
+            throw std::bad_alloc();
+        }
+        return static_cast<std::byte*>(buffer);
+    }
+
+    void Release(std::byte* buffer) {
+        {
+            std::scoped_lock lock(mutex_);
+            if (free_.size() < MAX_FREE) {
+                free_.push_back(buffer);
+                return;
+            }
+        }
+        std::free(buffer);
+    }
+
+    ~StagingBufferPool() {
+        for (std::byte* buffer : free_) {
+            std::free(buffer);
+        }
+    }
+
+private:
+    static constexpr size_t MAX_FREE = 16;
+
+    std::mutex mutex_;
+    std::vector<std::byte*> free_;
+};
+
+uint64_t AlignDown(uint64_t value) {
+    return value / DirectWriter::ALIGNMENT * DirectWriter::ALIGNMENT;
+}
+
+uint64_t AlignUp(uint64_t value) {
+    return AlignDown(value + DirectWriter::ALIGNMENT - 1);
+}
+
+} // namespace
+
+DirectWriter::DirectWriter(const std::vector<std::string>& paths, size_t block_size) : block_size_(block_size) {
+#ifdef O_DIRECT
+    if (block_size_ % ALIGNMENT != 0) {
+        throw std::invalid_argument("Block size must be a multiple of 4096 for direct I/O");
+    }
+    try {
+        for (const auto& path : paths) {
+            const int fd = open(path.c_str(), O_RDWR | O_DIRECT | O_DSYNC);
+            if (fd == -1) {
+                throw std::runtime_error("Failed to open queue file for direct I/O: " + path);
+            }
+            fds_.push_back(fd);
+        }
+        tail_page_ = static_cast<std::byte*>(std::aligned_alloc(ALIGNMENT, ALIGNMENT));
+        if (tail_page_ == nullptr) {
+            throw std::bad_alloc();
+        }
+    } catch (...) {
+        for (int fd : fds_) {
+            close(fd);
+        }
+        throw;
+    }
+#else
+    (void)paths;
+    throw std::runtime_error("Direct I/O is not supported on this platform");
+#endif
+}
+
+DirectWriter::~DirectWriter() {
+#ifdef O_DIRECT
+    if (chunk_ != nullptr) {
+        StagingBufferPool::Instance().Release(chunk_);
+    }
+    std::free(tail_page_);
+    for (int fd : fds_) {
+        close(fd);
+    }
+#endif
+}
+
+void DirectWriter::Stage(uint64_t offset, const void* data, size_t length) {
+    if (length == 0) {
+        return;
+    }
+    if (chunk_ != nullptr && offset != staged_end_) {
+        // 暂存数据之后的页内空间可能是回绕后的未消费记录，写出时保留原有内容
+        WriteChunk(true);
+    }
+    if (chunk_ == nullptr) {
+        chunk_ = StagingBufferPool::Instance().Acquire();
+        chunk_begin_ = AlignDown(offset);
+        staged_end_ = offset;
+        if (offset != chunk_begin_) {
+            // 首页中 offset 之前的内容需要保留
+            if (tail_offset_ == chunk_begin_) {
+                std::memcpy(chunk_, tail_page_, ALIGNMENT);
+            } else {
+                ReadPage(chunk_begin_, chunk_);
+            }
+        }
+        // 缓存的尾页将被覆盖，写出后重新缓存
+        tail_offset_ = UINT64_MAX;
+    }
+
+    const auto* source = static_cast<const std::byte*>(data);
+    while (length > 0) {
+        const size_t position = staged_end_ - chunk_begin_;
+        const size_t copy = std::min<size_t>(length, CHUNK_SIZE - position);
+        std::memcpy(chunk_ + position, source, copy);
+        source += copy;
+        length -= copy;
+        staged_end_ += copy;
+        if (staged_end_ - chunk_begin_ == CHUNK_SIZE) {
+            // 缓冲区写满，整块写出后继续暂存
+            WriteRange(chunk_begin_, chunk_, CHUNK_SIZE);
+            chunk_begin_ = staged_end_;
+        }
+    }
+}
+
+void DirectWriter::Flush(bool preserve_tail) {
+    if (chunk_ != nullptr) {
+        WriteChunk(preserve_tail);
+    }
+}
+
+void DirectWriter::Invalidate() {
+    tail_offset_ = UINT64_MAX;
+}
+
+void DirectWriter::Discard() {
+    if (chunk_ != nullptr) {
+        StagingBufferPool::Instance().Release(chunk_);
+        chunk_ = nullptr;
+    }
+}
+
+void DirectWriter::WriteChunk(bool preserve_tail) {
+    const size_t staged = staged_end_ - chunk_begin_;
+    const size_t length = AlignUp(staged);
+    if (length > staged) {
+        // 尾页中暂存数据之后的部分：需要保留时读出原有内容合并，否则填零
+        const uint64_t page_offset = AlignDown(staged_end_);
+        std::byte* page = chunk_ + (page_offset - chunk_begin_);
+        const size_t used = staged_end_ - page_offset;
+        if (preserve_tail) {
+            ReadPage(page_offset, tail_page_);
+            std::memcpy(page + used, tail_page_ + used, ALIGNMENT - used);
+        } else {
+            std::memset(page + used, 0, ALIGNMENT - used);
+        }
+    }
+    if (length > 0) {
+        WriteRange(chunk_begin_, chunk_, length);
+    }
+
+    if (length > staged) {
+        std::memcpy(tail_page_, chunk_ + (length - ALIGNMENT), ALIGNMENT);
+        tail_offset_ = chunk_begin_ + length - ALIGNMENT;
+    } else {
+        tail_offset_ = UINT64_MAX;
+    }
+    StagingBufferPool::Instance().Release(chunk_);
+    chunk_ = nullptr;
+}
+
+std::pair<int, uint64_t> DirectWriter::Locate(uint64_t offset) const {
+    const size_t stripes = fds_.size();
+    const uint64_t block_index = offset / block_size_;
+    return {fds_[block_index % stripes], block_index / stripes * block_size_ + offset % block_size_};
+}
+
+void DirectWriter::ReadPage(uint64_t offset, std::byte* page) {
+#ifdef O_DIRECT
+    const auto [fd, file_offset] = Locate(offset);
+    const ssize_t result = pread(fd, page, ALIGNMENT, static_cast<off_t>(file_offset));
+    if (result == -1) {
+        throw std::runtime_error("Failed to read page for direct I/O");
+    }
+    // 文件末尾之后的部分按零处理
+    std::memset(page + result, 0, ALIGNMENT - static_cast<size_t>(result));
+#else
+    (void)offset;
+    (void)page;
+#endif
+}
+
+void DirectWriter::WriteRange(uint64_t offset, const std::byte* data, size_t length) {
+#ifdef O_DIRECT
+    while (length > 0) {
+        const size_t in_block = std::min<uint64_t>(length, block_size_ - offset % block_size_);
+        const auto [fd, file_offset] = Locate(offset);
+        size_t written = 0;
+        while (written < in_block) {
+            const ssize_t result =
+                pwrite(fd, data + written, in_block - written, static_cast<off_t>(file_offset + written));
+            if (result == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::runtime_error("Failed to write queue file with direct I/O");
+            }
+            written += static_cast<size_t>(result);
+        }
+        offset += in_block;
+        data += in_block;
+        length -= in_block;
+    }
+#else
+    (void)offset;
+    (void)data;
+    (void)length;
+#endif
+}
+
+} // namespace persistent_file_queue
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace persistent_file_queue {
+
+// 直接 I/O 写入器：以 O_DIRECT | O_DSYNC 打开条带文件，绕过页缓存写入数据区（仅 Linux）。
+// 记录按逻辑偏移暂存到从进程内共享池中借出的对齐缓冲区，缓冲区写满时整块写出，
+// Flush 时写出剩余部分；首尾不完整的页先读出原有内容再合并写回（读-改-写），
+// 最后写出的不完整页缓存在内存中，连续追加时不需要重复读取。
+// 逻辑偏移到文件的映射与队列相同：块 i 位于条带 i % n 的第 i / n 个块
+class DirectWriter {
+public:
+    static constexpr size_t ALIGNMENT = 4096;           // 直接 I/O 的对齐粒度
+    static constexpr size_t CHUNK_SIZE = 1024 * 1024;   // 暂存缓冲区大小
+
+    DirectWriter(const std::vector<std::string>& paths, size_t block_size);
+
+    ~DirectWriter();
+
+    // 禁止拷贝和移动
+    DirectWriter(const DirectWriter&) = delete;
+    DirectWriter& operator=(const DirectWriter&) = delete;
+    DirectWriter(DirectWriter&&) = delete;
+    DirectWriter& operator=(DirectWriter&&) = delete;
+
+    // 暂存写入 offset 处的数据；与上一次暂存不连续时先写出已暂存的数据（保留最后一页中的原有内容）
+    void Stage(uint64_t offset, const void* data, size_t length);
+
+    // 写出所有暂存的数据，返回时数据已落盘。preserve_tail 为 true 时保留最后一页中暂存数据之后的原有内容
+    void Flush(bool preserve_tail);
+
+    // 丢弃缓存的尾页（文件被截断后调用）
+    void Invalidate();
+
+    // 丢弃尚未写出的暂存数据（写入失败或放弃的事务），不影响文件内容
+    void Discard();
+
+private:
+    // 写出 [chunk_begin_, AlignUp(staged_end_)) 并归还缓冲区
+    void WriteChunk(bool preserve_tail);
+    void ReadPage(uint64_t offset, std::byte* page);
+    // 按块拆分到各条带文件写入，offset 和 length 均已对齐
+    void WriteRange(uint64_t offset, const std::byte* data, size_t length);
+    // 逻辑偏移对应的条带文件和文件内偏移
+    std::pair<int, uint64_t> Locate(uint64_t offset) const;
+
+    std::vector<int> fds_;
+    size_t block_size_;
+    std::byte* chunk_ = nullptr;         // 当前暂存缓冲区
+    uint64_t chunk_begin_ = 0;           // 缓冲区对应的逻辑偏移（对齐）
+    uint64_t staged_end_ = 0;            // 已暂存数据的结束位置
+    std::byte* tail_page_ = nullptr;     // 最后写出的不完整页
+    uint64_t tail_offset_ = UINT64_MAX;  // 尾页的逻辑偏移，UINT64_MAX 表示没有缓存
+};
+
+} // namespace persistent_file_queue
@@ -1,25 +1,44 @@
 #include "persistent_file_queue/persistent_queue.h"
 
 #include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>
 #include <cstring>
+#include <deque>
 #include <filesystem>
 #include <fstream>
+#include <functional>
 #include <map>
 #include <span>
 #include <stdexcept>
+#include <thread>
 #include <vector>
 #include <spdlog/spdlog.h>
 #include <spdlog/sinks/rotating_file_sink.h>
 
+#include "delayed_record_store.h"
+#include "direct_writer.h"
+#include "queue_format.h"
+
 #ifdef _WIN32
+#include <io.h>
 #include <windows.h>
 #else
 #include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/file.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #endif
 
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+
 namespace fs = std::filesystem;
 
 // 简单的校验和计算：所有字节相加
@@ -34,41 +53,66 @@ std::byte CalculateChecksum(const std::byte* data, size_t length) {
 
 namespace persistent_file_queue {
 
-// 文件头部结构
-struct QueueHeader {
-    uint64_t head;       // 队列头位置
-    uint64_t tail;       // 队列尾位置
-    uint64_t capacity;   // 队列容量
-    uint64_t size;       // 当前队列大小（字节数）
-    uint64_t count;      // 当前队列中数据项的数量
-    uint64_t block_size; // 块大小
-    uint64_t max_size;   // 最大文件大小
-    uint64_t write_pos;  // 当前写入位置
-    uint64_t read_pos;   // 当前读取位置
-    uint64_t magic;      // 魔数，用于验证文件格式
-    uint64_t version;    // 版本号
-    std::byte checksum;  // 头部校验和
-};
-
 class PersistentQueue::Impl {
 public:
-    Impl(std::string_view queue_name, std::string_view storage_dir, size_t block_size, std::string_view log_dir)
-        : block_size_(block_size) {
-        // 处理存储路径
-        fs::path storage_path = fs::path(storage_dir) / (std::string(queue_name) + ".dat");
-        file_path_ = storage_path.string();
+    Impl(std::string_view queue_name, const QueueOptions& options)
+        : block_size_(options.block_size),
+          corruption_policy_(options.corruption_policy),
+          lane_count_(options.priority_lanes),
+          starvation_limit_(options.lane_starvation_limit),
+          lazy_open_(options.lazy_open),
+          memory_only_(options.memory_only),
+          format_version_(options.format_version),
+          record_alignment_(options.record_alignment),
+          punch_consumed_blocks_(options.punch_consumed_blocks),
+          shrink_idle_time_(options.shrink_idle_time),
+          adaptive_block_size_(options.adaptive_block_size),
+          visibility_timeout_(options.visibility_timeout) {
+        if (lane_count_ == 0 || lane_count_ > MAX_PRIORITY_LANES) {
+            throw std::invalid_argument("Invalid priority lane count");
+        }
+        lanes_.resize(lane_count_);
+        if (format_version_ != 0 && FindRecordFormat(format_version_) == nullptr) {
+            throw std::invalid_argument("Unsupported format version");
+        }
+        if (!IsValidRecordAlignment(record_alignment_)) {
+            throw std::invalid_argument("Invalid record alignment");
+        }
+        if (memory_only_ && options.direct_io) {
+            throw std::invalid_argument("Direct I/O is not supported for memory-only queues");
+        }
+
+        // 处理存储路径和条带文件路径
+        for (size_t stripe = 0; stripe <= options.stripe_dirs.size(); ++stripe) {
+            file_paths_.push_back(StripeFilePath(options, queue_name, stripe));
+        }
+        file_path_ = file_paths_[0];
+
+        // 处理隔离文件路径
+        if (options.quarantine_path.empty()) {
+            quarantine_path_ = (fs::path(options.storage_dir) / (std::string(queue_name) + ".quarantine")).string();
+        } else {
+            quarantine_path_ = options.quarantine_path;
+        }
         
+        // 延迟记录存储目录
+        delay_dir_ = fs::path(options.storage_dir) / (std::string(queue_name) + ".delay");
+
         // 处理日志路径
         std::string effective_log_path;
-        if (log_dir.empty()) {
+        if (options.log_dir.empty()) {
             effective_log_path = DEFAULT_LOG_DIR;
         } else {
-            effective_log_path = log_dir;
+            effective_log_path = options.log_dir;
         }
         
         // 确保存储目录和日志目录存在
         try {
-            fs::create_directories(storage_path.parent_path());
+            if (!memory_only_) {
+                for (const auto& path : file_paths_) {
+                    fs::create_directories(fs::path(path).parent_path());
+                }
+            }
             fs::create_directories(effective_log_path);
         } catch (const fs::filesystem_error& e) {
             spdlog::error("Failed to create directories: {}", e.what());
@@ -93,11 +137,17 @@ public:
         }
         logger_->info("PersistentQueue created with file: {}", file_path_);
         
-        // 打开或创建文件
-        OpenFile();
+        // 打开或创建所有条带文件
+        for (const auto& path : file_paths_) {
+            file_handles_.push_back(memory_only_ ? CreateMemoryFile(path) : OpenFile(path));
+        }
+        // 纯内存队列没有读取器，不需要通知文件
+        if (!memory_only_) {
+            OpenNotifyFile(NotifyFilePath(options, queue_name));
+        }
         
-        // 获取文件大小
-        const size_t file_size = GetFileSize();
+        // 获取主文件大小
+        const size_t file_size = GetFileSize(file_handles_[0]);
         
         // 如果是新文件，初始化它
         if (file_size == 0) {
@@ -108,9 +158,23 @@ public:
             MapHeaderBlock();
             RecoverFromFile();
         }
+        // 块大小在恢复后才确定
+        if (options.direct_io) {
+            direct_ = std::make_unique<DirectWriter>(file_paths_, block_size_);
+        }
+
+        // 恢复延迟记录索引
+        delayed_ = std::make_unique<DelayedRecordStore>(delay_dir_, options.delay_bucket_interval);
+        if (delayed_->Size() > 0) {
+            StartDeliveryTimer();
+        }
     }
 
     ~Impl() {
+        // 先停止后台线程，避免其访问即将解除映射的块
+        StopDeliveryTimer();
+        StopScrubber();
+
         // 确保头部信息写入磁盘
         FlushHeader();
         
@@ -118,113 +182,257 @@ public:
         for (auto& [_, block] : mapped_blocks_) {
             UnmapBlock(block);
         }
-        if (file_handle_ != InvalidHandle) {
-            CloseFile();
+        ReleaseAddressSpace();
+        for (FileHandle handle : file_handles_) {
+            if (handle != InvalidHandle) {
+                CloseFile(handle);
+            }
+        }
+#ifndef _WIN32
+        for (int fd : {data_fd_, space_fd_}) {
+            if (fd != -1) {
+                close(fd);
+            }
         }
+        if (notify_ != nullptr) {
+            munmap(notify_, sizeof(NotifyState));
+        }
+#endif
+        // 日志记录器由同一进程中的所有队列共享，保留在注册表中
         logger_->info("PersistentQueue destroyed");
-        spdlog::drop("persistent_queue");  // 关闭日志记录器
     }
 
-    bool Enqueue(const std::vector<std::byte>& data) {
-        logger_->debug("Enqueue data with size: {}", data.size());
+    bool Enqueue(const std::vector<std::byte>& data, size_t priority) {
+        logger_->debug("Enqueue data with size: {}, priority: {}", data.size(), priority);
         std::scoped_lock lock(mutex_);
+        CheckPriority(priority);
+        if (data.size() >= WRAP_MARKER) {
+            throw std::invalid_argument("Data too large");
+        }
+        if (!AppendRecord(data, priority)) {
+            return false;
+        }
         
-        // 计算需要写入的总大小（数据大小 + 大小字段 + 校验和）
-        const size_t total_size = sizeof(uint32_t) + data.size() + sizeof(std::byte);
-        
-        // 检查是否有足够的空间
-        if (header_->size + total_size > header_->capacity) {
-            if (header_->capacity >= header_->max_size) {
-                // 如果达到最大大小，检查是否有可回收的空间
-                if (CanRecycleSpace(total_size)) {
-                    // 更新读取位置，回收空间
-                    UpdateReadPosition();
-                } else {
-                    spdlog::warn("Queue is full and cannot recycle space");
-                    return false;  // 队列已满且无法回收空间
+        // 更新头部信息
+        FlushHeader();
+
+        logger_->debug("Data enqueued successfully, new size: {}, count: {}", 
+                      header_->size, header_->count);
+        return true;
+    }
+
+    bool CommitTxn(const std::vector<std::vector<std::byte>>& records, size_t priority) {
+        logger_->debug("Commit transaction with {} records, priority: {}", records.size(), priority);
+        std::scoped_lock lock(mutex_);
+        CheckPriority(priority);
+        for (const auto& data : records) {
+            if (data.size() >= WRAP_MARKER) {
+                throw std::invalid_argument("Data too large");
+            }
+        }
+        if (records.empty()) {
+            return true;
+        }
+
+        while (true) {
+            // 记录写入写入位置之后的空闲空间，头部保持不变，提交前崩溃时这些数据在恢复后不可见
+            Ring ring = GetRing(priority);
+            uint64_t read_pos = ring.read_pos;
+            uint64_t write_pos = ring.write_pos;
+            uint64_t size = ring.size;
+            uint64_t count = ring.count;
+            Ring staged{read_pos, write_pos, size, count, ring.begin, ring.end};
+            bool fits = true;
+            try {
+                for (const auto& data : records) {
+                    const size_t total_size = format_.RecordSize(data.size());
+                    if (NeedsExpand(staged, total_size)) {
+                        fits = false;
+                        break;
+                    }
+                    size += StageRecord(staged, data, total_size);
+                    count++;
+                }
+            } catch (...) {
+                DiscardStaged();
+                throw;
+            }
+            if (!fits) {
+                // 空间不足时丢弃已暂存的记录，扩展文件后重新写入
+                DiscardStaged();
+                if (!CanExpand()) {
+                    MarkFull();
+                    spdlog::warn("Queue is full");
+                    return false;
                 }
-            } else {
-                // 扩展文件
                 ExpandFile();
+                continue;
+            }
+
+            // 先让数据落盘，再一次性更新头部，使事务中的记录同时可见
+            FlushRingRange(ring, ring.write_pos, write_pos);
+            ring.write_pos = write_pos;
+            AddUsage(ring, size - ring.size, count - ring.count);
+            for (const auto& data : records) {
+                CountRecordSize(data.size());
             }
+            FlushHeader();
+
+            logger_->debug("Transaction committed, new size: {}, count: {}", header_->size, header_->count);
+            return true;
         }
+    }
 
-        // 确保写入位置块已映射
-        EnsureBlockMapped(header_->write_pos / block_size_);
-        
-        // 写入数据大小
-        uint32_t data_size = static_cast<uint32_t>(data.size());
-        std::byte* write_pos = GetBlockPtr(header_->write_pos);
-        std::memcpy(write_pos, &data_size, sizeof(uint32_t));
-        
-        // 写入实际数据
-        write_pos += sizeof(uint32_t);
-        std::memcpy(write_pos, data.data(), data.size());
-        
-        // 计算并写入校验和
-        write_pos += data.size();
-        std::byte checksum = CalculateChecksum(data.data(), data.size());
-        *write_pos = checksum;
-        
-        // 确保数据写入磁盘
-        FlushBlock(header_->write_pos / block_size_);
-        
-        // 更新队列状态
-        header_->write_pos = (header_->write_pos + total_size) % header_->capacity;
-        header_->size += total_size;
-        header_->count += 1;  // 增加数据项计数
-        
-        // 更新头部信息
+    EnqueueStatus EnqueueIdempotent(uint64_t producer_id, uint64_t sequence, const std::vector<std::byte>& data,
+                                    size_t priority) {
+        logger_->debug("Enqueue data with size: {}, producer: {}, sequence: {}", data.size(), producer_id, sequence);
+        std::scoped_lock lock(mutex_);
+        CheckPriority(priority);
+        if (producer_id == 0) {
+            throw std::invalid_argument("Producer id must be non-zero");
+        }
+        if (data.size() >= WRAP_MARKER) {
+            throw std::invalid_argument("Data too large");
+        }
+
+        ProducerEntry* entry = FindProducer(producer_id);
+        if (entry == nullptr) {
+            throw std::runtime_error("Producer table is full");
+        }
+        if (entry->producer_id == producer_id && sequence < entry->next_sequence) {
+            logger_->debug("Duplicate sequence {} from producer {}", sequence, producer_id);
+            return EnqueueStatus::kDuplicate;
+        }
+        if (!AppendRecord(data, priority)) {
+            return EnqueueStatus::kFull;
+        }
+
+        // 生产者序列号与记录在同一次头部刷新中生效
+        entry->producer_id = producer_id;
+        entry->next_sequence = sequence + 1;
         FlushHeader();
+        return EnqueueStatus::kEnqueued;
+    }
 
-        logger_->debug("Data enqueued successfully, new size: {}, count: {}", 
-                      header_->size, header_->count);
+    std::optional<uint64_t> LastSequence(uint64_t producer_id) const {
+        std::scoped_lock lock(mutex_);
+        const ProducerEntry* entry = FindProducer(producer_id);
+        if (producer_id == 0 || entry == nullptr || entry->producer_id != producer_id) {
+            return std::nullopt;
+        }
+        return entry->next_sequence - 1;
+    }
+
+    bool RemoveProducer(uint64_t producer_id) {
+        std::scoped_lock lock(mutex_);
+        ProducerEntry* entry = FindProducer(producer_id);
+        if (producer_id == 0 || entry == nullptr || entry->producer_id != producer_id) {
+            return false;
+        }
+        EraseProducer(static_cast<size_t>(entry - header_->producers));
+        FlushHeader();
+        logger_->info("Removed producer {}", producer_id);
+        return true;
+    }
+
+    // 投递时间未到时写入延迟存储并返回 true；已到期时返回 false，由调用方直接入队
+    bool EnqueueDelayed(const std::vector<std::byte>& data, std::chrono::system_clock::time_point deliver_after) {
+        const int64_t deliver_at_ns =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(deliver_after.time_since_epoch()).count();
+        std::scoped_lock lock(mutex_);
+        if (deliver_at_ns <= NowNanoseconds()) {
+            return false;
+        }
+        if (data.size() >= WRAP_MARKER) {
+            throw std::invalid_argument("Data too large");
+        }
+        delayed_->Add(deliver_at_ns, data);
+        logger_->debug("Delayed data with size: {}, deliver at: {}", data.size(), deliver_at_ns);
+        StartDeliveryTimer();
         return true;
     }
 
     std::optional<std::vector<std::byte>> Dequeue() {
         logger_->debug("Attempting to dequeue data");
         std::scoped_lock lock(mutex_);
-        
-        if (header_->count == 0) {
-            spdlog::debug("Queue is empty");
-            return std::nullopt;  // 队列为空
+        CheckNoLeases();
+        PromoteDueRecords();
+        while (header_->count > 0) {
+            // 损坏记录被跳过后所选通道可能变空，此时重新选择通道
+            auto data = ReadFront(SelectLane(true), true);
+            if (data) {
+                return data;
+            }
         }
+        spdlog::debug("Queue is empty");
+        return std::nullopt;  // 队列为空
+    }
 
-        // 确保读取位置块已映射
-        EnsureBlockMapped(header_->read_pos / block_size_);
-        
-        // 读取数据大小
-        uint32_t data_size;
-        std::memcpy(&data_size, GetBlockPtr(header_->read_pos), sizeof(uint32_t));
-        
-        // 计算总大小（数据大小 + 大小字段 + 校验和）
-        const size_t total_size = sizeof(uint32_t) + data_size + sizeof(std::byte);
-        
-        // 分配空间并读取数据
-        std::vector<std::byte> data(data_size);
-        std::memcpy(data.data(), GetBlockPtr(header_->read_pos + sizeof(uint32_t)), data_size);
-        
-        // 读取并验证校验和
-        std::byte stored_checksum = *(GetBlockPtr(header_->read_pos + sizeof(uint32_t) + data_size));
-        std::byte calculated_checksum = CalculateChecksum(data.data(), data_size);
-        
-        if (stored_checksum != calculated_checksum) {
-            spdlog::error("Data corruption detected: checksum mismatch");
-            throw std::runtime_error("Data corruption detected: checksum mismatch");
+    size_t ForEach(size_t max_items, const RecordVisitor& visitor, size_t checkpoint_interval) {
+        std::scoped_lock lock(mutex_);
+        CheckNoLeases();
+        PromoteDueRecords();
+
+        // 各通道上次提交时的读取位置，提交时释放从这里到当前读取位置之间已消费的块
+        std::vector<uint64_t> committed_pos(lane_count_);
+        for (size_t lane = 0; lane < lane_count_; ++lane) {
+            committed_pos[lane] = GetRing(lane).read_pos;
         }
-        
-        // 更新队列状态
-        header_->read_pos = (header_->read_pos + total_size) % header_->capacity;
-        header_->size -= total_size;
-        header_->count -= 1;  // 减少数据项计数
-        
-        // 更新头部信息
-        FlushHeader();
+        size_t processed = 0;
+        size_t pending = 0;
+        auto commit = [&] {
+            if (pending == 0) {
+                return;
+            }
+            FlushHeader();
+            for (size_t lane = 0; lane < lane_count_; ++lane) {
+                Ring ring = GetRing(lane);
+                ReleaseConsumed(ring, committed_pos[lane], ring.read_pos);
+                committed_pos[lane] = ring.read_pos;
+            }
+            pending = 0;
+        };
 
-        logger_->debug("Data dequeued successfully, remaining size: {}, count: {}", 
-                      header_->size, header_->count);
-        return data;
+        try {
+            while (processed < max_items && header_->count > 0) {
+                // 损坏记录被跳过后所选通道可能变空，此时重新选择通道
+                const size_t lane = SelectLane(true);
+                auto front = LocateFront(lane);
+                if (!front) {
+                    continue;
+                }
+                if (!visitor(RecordView{front->data, front->data_size})) {
+                    break;
+                }
+                ConsumeFront(lane, *front);
+                processed++;
+                pending++;
+                if (checkpoint_interval > 0 && pending >= checkpoint_interval) {
+                    commit();
+                }
+            }
+        } catch (...) {
+            // 回调或损坏处理抛出异常时，已交给回调处理完成的记录照常出队
+            commit();
+            throw;
+        }
+        commit();
+        logger_->debug("Batch dequeued {} records, remaining size: {}, count: {}", processed, header_->size,
+                       header_->count);
+        return processed;
+    }
+
+    std::optional<std::vector<std::byte>> Peek() {
+        std::scoped_lock lock(mutex_);
+        CheckNoLeases();
+        PromoteDueRecords();
+        while (header_->count > 0) {
+            auto data = ReadFront(SelectLane(false), false);
+            if (data) {
+                return data;
+            }
+        }
+        return std::nullopt;
     }
 
     size_t Size() const {
@@ -246,6 +454,323 @@ public:
         return header_->count == 0;
     }
 
+    size_t LaneSize(size_t priority) const {
+        std::scoped_lock lock(mutex_);
+        CheckPriority(priority);
+        return lane_count_ == 1 ? header_->count : header_->lanes[priority].count;
+    }
+
+    size_t DelayedSize() const {
+        std::scoped_lock lock(mutex_);
+        return delayed_->Size();
+    }
+
+    std::optional<LeasedRecord> Receive() {
+        std::scoped_lock lock(mutex_);
+        PromoteDueRecords();
+
+        // 优先重新投递已超时的租约，已确认的条目直接丢弃
+        const auto now = std::chrono::steady_clock::now();
+        while (!lease_deadlines_.empty()) {
+            LeaseDeadline lease = lease_deadlines_.front();
+            if (IsAcked(lease.lane, lease.seq)) {
+                lease_deadlines_.pop_front();
+                continue;
+            }
+            if (lease.deadline > now) {
+                break;
+            }
+            lease_deadlines_.pop_front();
+            lease.deadline = now + visibility_timeout_;
+            lease_deadlines_.push_back(lease);
+            // 重新投递换用新的代次，之前发出的租约标识随之失效
+            LaneRuntime& runtime = lanes_[lease.lane];
+            const uint64_t generation = ++runtime.generations[lease.seq - runtime.base_seq];
+            logger_->debug("Redelivering record at offset: {} after visibility timeout", lease.pos);
+            return LeasedRecord{MakeLeaseId(lease.lane, lease.seq, generation), ReadRecordAt(lease.pos)};
+        }
+
+        while (true) {
+            const size_t lane = SelectLeaseLane();
+            if (lane == lane_count_) {
+                return std::nullopt;
+            }
+            Ring ring = GetRing(lane);
+            LaneRuntime& runtime = lanes_[lane];
+            if (runtime.next_seq == runtime.base_seq) {
+                runtime.lease_cursor = ring.read_pos;
+            }
+
+            uint64_t padding = 0;
+            const uint64_t start = ResolveRecordStart(ring, runtime.lease_cursor, padding);
+            EnsureRangeMapped(start, sizeof(uint32_t));
+            uint32_t data_size;
+            std::memcpy(&data_size, GetBlockPtr(start), sizeof(uint32_t));
+            const size_t total_size = format_.RecordSize(data_size);
+            if (padding + total_size > ring.size) {
+                // 前面还有未确认的记录时不能丢弃整个通道
+                if (runtime.next_seq != runtime.base_seq) {
+                    corruption_stats_.detected++;
+                    spdlog::error("Data corruption detected: invalid data size");
+                    throw std::runtime_error("Data corruption detected: invalid data size");
+                }
+                HandleFramingCorruption(lane);
+                continue;
+            }
+            EnsureRangeMapped(start, total_size);
+            const std::byte* payload = GetBlockPtr(start + sizeof(uint32_t));
+            std::vector<std::byte> data(payload, payload + data_size);
+            const bool corrupted = !format_.VerifyChecksum(payload, data_size);
+            if (corrupted) {
+                ReportCorruptRecord(start, payload, data_size);
+            }
+
+            // 分配序号并在确认位图中预留一位
+            const uint64_t seq = runtime.next_seq++;
+            runtime.lease_cursor = RingAdvance(ring, start, total_size);
+            runtime.generations.push_back(0);
+            while ((seq - runtime.acked_base) / 64 >= runtime.acked.size()) {
+                runtime.acked.push_back(0);
+            }
+
+            if (corrupted) {
+                // 损坏记录按已确认处理，不投递给调用方
+                corruption_stats_.skipped++;
+                logger_->error("Skipped corrupted record at offset: {}, size: {}", start, total_size);
+                MarkAcked(lane, seq);
+                CommitAcked(lane);
+                continue;
+            }
+            lease_deadlines_.push_back({now + visibility_timeout_, lane, seq, start});
+            leased_count_++;
+            return LeasedRecord{MakeLeaseId(lane, seq, 0), std::move(data)};
+        }
+    }
+
+    bool Ack(uint64_t lease_id) {
+        std::scoped_lock lock(mutex_);
+        const size_t lane = static_cast<size_t>(lease_id >> LEASE_LANE_SHIFT);
+        const uint64_t generation = (lease_id >> LEASE_GENERATION_SHIFT) & LEASE_GENERATION_MASK;
+        const uint64_t seq = lease_id & ((1ULL << LEASE_GENERATION_SHIFT) - 1);
+        if (lane >= lane_count_) {
+            return false;
+        }
+        const LaneRuntime& runtime = lanes_[lane];
+        if (seq >= runtime.next_seq || IsAcked(lane, seq)) {
+            return false;
+        }
+        // 记录已被重新投递时，旧租约的处理者可能与新租约的处理者并发，拒绝旧租约的确认
+        if (generation != (runtime.generations[seq - runtime.base_seq] & LEASE_GENERATION_MASK)) {
+            logger_->debug("Rejected stale lease {} for record {} in lane {}", lease_id, seq, lane);
+            return false;
+        }
+        MarkAcked(lane, seq);
+        leased_count_--;
+        CommitAcked(lane);
+        return true;
+    }
+
+    size_t LeasedCount() const {
+        std::scoped_lock lock(mutex_);
+        return leased_count_;
+    }
+
+    int DataAvailableFd() {
+        std::scoped_lock lock(mutex_);
+        if (data_fd_ == -1) {
+            data_fd_ = CreateEventFd();
+            data_signaled_ = false;
+            PublishState();
+        }
+        return data_fd_;
+    }
+
+    int SpaceAvailableFd() {
+        std::scoped_lock lock(mutex_);
+        if (space_fd_ == -1) {
+            space_fd_ = CreateEventFd();
+        }
+        return space_fd_;
+    }
+
+    void SetDataAvailableCallback(std::function<void()> callback) {
+        std::scoped_lock lock(callback_mutex_);
+        data_available_ = std::move(callback);
+    }
+
+    // 在队列锁之外调用，持有回调锁保证回调被替换后不再被调用
+    void NotifyDataAvailable() {
+        std::scoped_lock lock(callback_mutex_);
+        // 回调中可能替换回调本身，先复制一份再调用
+        const std::function<void()> callback = data_available_;
+        if (callback) {
+            callback();
+        }
+    }
+
+    void StartScrubber(ScrubberOptions options) {
+        StopScrubber();
+        if (options.bytes_per_second == 0) {
+            throw std::invalid_argument("Scrubber rate must be positive");
+        }
+        {
+            std::scoped_lock lock(scrub_mutex_);
+            scrub_stop_ = false;
+        }
+        {
+            std::scoped_lock lock(mutex_);
+            scrubber_running_ = true;
+        }
+        logger_->info("Scrubber started, rate limit: {} bytes/s", options.bytes_per_second);
+        scrubber_ = std::thread([this, options = std::move(options)] { ScrubLoop(options); });
+    }
+
+    void StopScrubber() {
+        if (!scrubber_.joinable()) {
+            return;
+        }
+        {
+            std::scoped_lock lock(scrub_mutex_);
+            scrub_stop_ = true;
+        }
+        scrub_cv_.notify_all();
+        scrubber_.join();
+        {
+            std::scoped_lock lock(mutex_);
+            scrubber_running_ = false;
+        }
+        logger_->info("Scrubber stopped");
+    }
+
+    size_t ScrubbedBytes() const {
+        std::scoped_lock lock(mutex_);
+        size_t verified = 0;
+        for (const auto& lane : lanes_) {
+            verified += lane.verified_bytes;
+        }
+        return verified;
+    }
+
+    CorruptionStats GetCorruptionStats() const {
+        std::scoped_lock lock(mutex_);
+        return corruption_stats_;
+    }
+
+    RecordSizeStats GetRecordSizeStats() const {
+        std::scoped_lock lock(mutex_);
+        RecordSizeStats stats;
+        std::copy(std::begin(header_->record_sizes), std::end(header_->record_sizes), stats.buckets);
+        return stats;
+    }
+
+    size_t MappedBytes() const {
+        std::scoped_lock lock(mutex_);
+        return HEADER_BLOCK_SIZE + mapped_blocks_.size() * block_size_;
+    }
+
+    bool Preallocate() {
+        std::scoped_lock lock(mutex_);
+        bool prepared = false;
+        // 剩余空间不足一个块时提前扩展文件
+        if (CanExpand() && header_->capacity - block_size_ - header_->size < block_size_) {
+            ExpandFile();
+            prepared = true;
+        }
+        for (size_t lane = 0; lane < lane_count_; ++lane) {
+            const Ring ring = GetRing(lane);
+            uint64_t next = (ring.write_pos / block_size_ + 1) * block_size_;
+            if (next >= ring.end) {
+                next = ring.begin;
+            }
+            const size_t block_index = next / block_size_;
+            if (mapped_blocks_.find(block_index) != mapped_blocks_.end()) {
+                continue;
+            }
+            AllocateBlock(block_index);
+            MapBlock(block_index);
+            prepared = true;
+        }
+        return prepared;
+    }
+
+    size_t Compact() {
+        std::scoped_lock lock(mutex_);
+        const bool idle = IdleFor(shrink_idle_time_);
+        if (lane_count_ != 1) {
+            return 0;
+        }
+        Ring ring = GetRing(0);
+        if (ring.count == 0) {
+            if (ring.read_pos != ring.begin || ring.write_pos != ring.begin) {
+                // 队列为空（可能只剩提前回绕留下的填充）：读写位置回到数据区起始位置
+                ring.read_pos = ring.begin;
+                ring.write_pos = ring.begin;
+                RemoveUsage(ring, ring.size, 0);
+                lanes_[0].verified_bytes = 0;
+                scrub_epoch_++;
+                FlushHeader();
+            }
+        } else if (ring.write_pos > ring.read_pos && ring.read_pos - ring.begin >= (ring.end - ring.begin) / 2 &&
+                   ring.end > 2 * block_size_) {
+            // 数据全部位于数据区后半部分：提前回绕，后续记录写到前部，读取位置越过回绕点后即可收缩
+            WrapEarly(ring);
+            observed_activity_ = activity_;
+            return 0;
+        }
+        size_t released = 0;
+        if (idle) {
+            released = ring.count == 0 && adaptive_block_size_ ? AdaptBlockSize() : 0;
+            released += ShrinkFile(GetRing(0));
+        }
+        // 压缩自身刷新头部不算作队列活动
+        observed_activity_ = activity_;
+        return released;
+    }
+
+    size_t Snapshot(const std::string& path) {
+#ifdef _WIN32
+        (void)path;
+        throw std::runtime_error("Snapshot is not supported on this platform");
+#else
+        const std::string temp_path = path + ".tmp";
+        const int fd = open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd == -1) {
+            throw std::runtime_error("Failed to create snapshot file: " + temp_path);
+        }
+        SnapshotState state;
+        try {
+            // 先在锁外复制，复制期间记录被覆盖时重试，多次失败后在锁内复制
+            for (size_t attempt = 0;; ++attempt) {
+                const bool locked = attempt == SNAPSHOT_ATTEMPTS;
+                std::unique_lock lock(mutex_);
+                state = CaptureSnapshotState();
+                if (!locked) {
+                    lock.unlock();
+                }
+                WriteSnapshot(state, fd);
+                if (!locked) {
+                    lock.lock();
+                }
+                if (locked || SnapshotIntact(state)) {
+                    break;
+                }
+                logger_->warn("Records were overwritten while taking snapshot, retrying");
+            }
+            if (fsync(fd) == -1) {
+                throw std::runtime_error("Failed to sync snapshot file: " + temp_path);
+            }
+        } catch (...) {
+            close(fd);
+            fs::remove(temp_path);
+            throw;
+        }
+        close(fd);
+        fs::rename(temp_path, path);
+        logger_->info("Snapshot of {} records written to: {}", state.header.count, path);
+        return state.header.count;
+#endif
+    }
+
 private:
 #ifdef _WIN32
     using FileHandle = HANDLE;
@@ -255,27 +780,198 @@ private:
     static constexpr FileHandle InvalidHandle = -1;
 #endif
 
-    static constexpr uint64_t MAGIC_NUMBER = 0xDEADBEEFCAFEBABE;
-    static constexpr uint64_t CURRENT_VERSION = 1;
+    // 租约标识的高 8 位为通道号，其后 16 位为投递代次（每次重新投递加一），低 40 位为通道内的投递序号
+    static constexpr unsigned LEASE_LANE_SHIFT = 56;
+    static constexpr unsigned LEASE_GENERATION_SHIFT = 40;
+    static constexpr uint64_t LEASE_GENERATION_MASK = (1ULL << (LEASE_LANE_SHIFT - LEASE_GENERATION_SHIFT)) - 1;
+
+    // 环形区域视图：单通道时引用头部的读写位置，多通道时引用对应通道的状态
+    struct Ring {
+        uint64_t& read_pos;
+        uint64_t& write_pos;
+        uint64_t& size;
+        uint64_t& count;
+        uint64_t begin;  // 区域起始位置
+        uint64_t end;    // 区域结束位置
+    };
+
+    // 通道的进程内状态（受 mutex_ 保护）
+    struct LaneRuntime {
+        uint64_t verified_bytes = 0;  // 从读取位置起已巡检通过的字节数
+        uint64_t consumed_bytes = 0;  // 本进程内累计出队的字节数，用于判断巡检结果是否过期
+        // 租约模式：序号 [base_seq, next_seq) 的记录已投递但读取位置尚未越过，base_seq 对应读取位置处的记录
+        uint64_t lease_cursor = 0;    // 下一条待投递记录的位置
+        uint64_t base_seq = 0;
+        uint64_t next_seq = 0;
+        uint64_t acked_base = 0;      // 确认位图第一个字对应的序号（64 的倍数）
+        std::deque<uint64_t> acked;   // 确认位图，每位对应一条已投递的记录
+        std::deque<uint64_t> generations;  // 序号 [base_seq, next_seq) 的记录当前的投递代次
+    };
+
+    // 租约超时队列条目，可见性超时固定，因此按投递顺序即按超时时间排序
+    struct LeaseDeadline {
+        std::chrono::steady_clock::time_point deadline;
+        size_t lane;
+        uint64_t seq;
+        uint64_t pos;  // 记录起始位置（已跳过回绕填充）
+    };
 
     struct MappedBlock {
         std::byte* data;
         size_t ref_count;
     };
 
+    // 待巡检记录：在锁内定位，在锁外校验
+    struct ScrubItem {
+        uint64_t offset;              // 记录在文件中的偏移量
+        uint64_t padding;             // 记录之前因回绕跳过的字节数
+        const std::byte* payload;     // 数据起始地址
+        uint32_t data_size;           // 数据大小，校验和紧跟在数据之后
+    };
+
+    // 单轮巡检最多处理的字节数，控制持锁时间和速率限制的粒度
+    static constexpr size_t SCRUB_BATCH_BYTES = 1024 * 1024;
+
+    // 投递定时线程的最长等待时间，以及到期记录因队列已满无法转入时的重试间隔
+    static constexpr std::chrono::nanoseconds MAX_DELIVERY_WAIT = std::chrono::seconds(1);
+    static constexpr std::chrono::nanoseconds DELIVERY_RETRY_INTERVAL = std::chrono::milliseconds(100);
+
+    // 自适应块大小：至少写入这么多条记录后才按分布调整，推荐值与当前块大小相差这么多倍以上才调整
+    static constexpr uint64_t ADAPTIVE_MIN_RECORDS = 1024;
+    static constexpr size_t ADAPTIVE_BLOCK_RATIO = 4;
+
+    void ScrubLoop(const ScrubberOptions& options) {
+#ifdef __linux__
+        // 以最低调度优先级运行，避免与生产者/消费者争抢 CPU
+        sched_param param{};
+        pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+#endif
+        using Clock = std::chrono::steady_clock;
+        const auto start = Clock::now();
+        uint64_t scrubbed_total = 0;
+        std::pair<size_t, uint64_t> last_reported{SIZE_MAX, 0};
+        size_t next_lane = 0;
+
+        while (true) {
+            std::vector<ScrubItem> items;
+            size_t lane = 0;
+            uint64_t logical_begin = 0;
+            uint64_t epoch = 0;
+            bool framing_error = false;
+            uint64_t error_offset = 0;
+            {
+                std::scoped_lock lock(mutex_);
+                epoch = scrub_epoch_;
+
+                // 轮流巡检有待巡检数据的通道
+                for (size_t i = 0; i < lane_count_; ++i) {
+                    lane = (next_lane + i) % lane_count_;
+                    if (GetRing(lane).size > lanes_[lane].verified_bytes) {
+                        break;
+                    }
+                }
+                next_lane = lane + 1;
+
+                Ring ring = GetRing(lane);
+                const LaneRuntime& runtime = lanes_[lane];
+                logical_begin = runtime.consumed_bytes + runtime.verified_bytes;
+                uint64_t pending = ring.size - runtime.verified_bytes;
+                uint64_t pos = RingAdvance(ring, ring.read_pos, runtime.verified_bytes);
+                size_t batch_bytes = 0;
+                while (pending > 0 && batch_bytes < SCRUB_BATCH_BYTES) {
+                    uint64_t padding = 0;
+                    const uint64_t start = ResolveRecordStart(ring, pos, padding);
+                    EnsureRangeMapped(start, sizeof(uint32_t));
+                    uint32_t data_size;
+                    std::memcpy(&data_size, GetBlockPtr(start), sizeof(uint32_t));
+                    const size_t total_size = format_.RecordSize(data_size);
+                    if (padding + total_size > pending) {
+                        framing_error = true;
+                        error_offset = start;
+                        break;
+                    }
+                    EnsureRangeMapped(start, total_size);
+                    items.push_back({start, padding, GetBlockPtr(start + sizeof(uint32_t)), data_size});
+                    pos = RingAdvance(ring, start, total_size);
+                    pending -= padding + total_size;
+                    batch_bytes += padding + total_size;
+                }
+            }
+
+            // 在锁外计算校验和，只保留连续通过校验的前缀
+            size_t verified = 0;
+            std::optional<uint64_t> corrupt_offset;
+            std::string_view corrupt_reason;
+            for (const auto& item : items) {
+                if (!format_.VerifyChecksum(item.payload, item.data_size)) {
+                    corrupt_offset = item.offset;
+                    corrupt_reason = "checksum mismatch";
+                    break;
+                }
+                verified += item.padding + format_.RecordSize(item.data_size);
+            }
+            if (!corrupt_offset && framing_error) {
+                corrupt_offset = error_offset;
+                corrupt_reason = "invalid data size";
+            }
+
+            bool still_pending = false;
+            {
+                std::scoped_lock lock(mutex_);
+                // 巡检期间记录未被消费、读取位置未跳变时，结果才有效
+                LaneRuntime& runtime = lanes_[lane];
+                still_pending =
+                    epoch == scrub_epoch_ && runtime.consumed_bytes + runtime.verified_bytes == logical_begin;
+                if (still_pending) {
+                    runtime.verified_bytes += verified;
+                }
+            }
+            scrubbed_total += verified;
+
+            if (still_pending && corrupt_offset) {
+                // 同一条损坏记录只上报一次
+                const std::pair<size_t, uint64_t> logical_offset{lane, logical_begin + verified};
+                if (logical_offset != last_reported) {
+                    last_reported = logical_offset;
+                    logger_->error("Scrubber detected data corruption at offset: {}", *corrupt_offset);
+                    if (options.on_corruption) {
+                        options.on_corruption(*corrupt_offset, corrupt_reason);
+                    }
+                }
+            }
+
+            // 速率限制：按已巡检字节数推算下一轮的最早开始时间
+            std::unique_lock lock(scrub_mutex_);
+            auto next = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(
+                                    static_cast<double>(scrubbed_total) / options.bytes_per_second));
+            if (items.empty() || corrupt_offset || !still_pending) {
+                next = std::max(next, Clock::now() + options.idle_interval);
+            }
+            if (scrub_cv_.wait_until(lock, next, [this] { return scrub_stop_; })) {
+                return;
+            }
+        }
+    }
+
     void Initialize() {
-        // 计算初始块数（至少4个块，每个块64MB）
-        const size_t initial_blocks = std::max<size_t>(4, (1ULL << 30) / block_size_); // 1GB / block_size
+        format_ = ResolveRecordFormat(format_version_ != 0 ? format_version_ : DEFAULT_FORMAT_VERSION, record_alignment_);
+        // 计算初始块数（至少4个块，每个块64MB）；延迟打开的单通道队列只分配一个数据块，写入时按需扩展
+        const size_t initial_blocks = lazy_open_ && lane_count_ == 1
+                                          ? 2
+                                          : std::max<size_t>(4, (1ULL << 30) / block_size_); // 1GB / block_size
         const size_t initial_size = initial_blocks * block_size_;
 
         // 调整文件大小
-        ResizeFile(initial_size);
+        ResizeStripes(initial_size);
 
         // 映射头部块（使用单独的头部块）
         MapHeaderBlock();
         
         // 初始化头部
         InitializeNewFile(initial_size);
+
+        // 为数据块预留连续的地址空间
+        ReserveAddressSpace(header_->max_size);
     }
 
     void InitializeNewFile(size_t initial_size) {
@@ -287,15 +983,35 @@ private:
         header_->count = 0;
         header_->block_size = block_size_;
         header_->max_size = 1ULL << 30; // 1GB
-        header_->write_pos = block_size_;
-        header_->read_pos = block_size_;
         header_->magic = MAGIC_NUMBER;
-        header_->version = CURRENT_VERSION;
+        header_->version = format_.version;
+        header_->record_alignment = record_alignment_;
+        HeaderWritePos(*header_) = block_size_;
+        HeaderReadPos(*header_) = block_size_;
+        header_->stripe_count = file_handles_.size();
+        header_->lane_count = lane_count_;
+        if (lane_count_ > 1) {
+            // 将数据区按块均分给各通道，最后一个通道占用剩余的块
+            const size_t data_blocks = initial_size / block_size_ - 1;
+            if (data_blocks < lane_count_) {
+                throw std::invalid_argument("Not enough blocks for priority lanes");
+            }
+            const size_t lane_blocks = data_blocks / lane_count_;
+            for (size_t lane = 0; lane < lane_count_; ++lane) {
+                LaneHeader& state = header_->lanes[lane];
+                state.begin = (1 + lane * lane_blocks) * block_size_;
+                state.end = lane + 1 == lane_count_ ? initial_size : state.begin + lane_blocks * block_size_;
+                state.write_pos = state.begin;
+                state.read_pos = state.begin;
+                state.size = 0;
+                state.count = 0;
+            }
+        }
         
         // 计算头部校验和
         header_->checksum = CalculateChecksum(
             reinterpret_cast<const std::byte*>(header_),
-            sizeof(QueueHeader) - sizeof(std::byte)
+            offsetof(QueueHeader, checksum)
         );
         
         // 确保头部信息写入磁盘
@@ -311,12 +1027,25 @@ private:
             throw std::runtime_error("Invalid file format: magic number mismatch");
         }
 
-        if (header_->version != CURRENT_VERSION) {
-            throw std::runtime_error("Unsupported file version");
+        // 已有文件按头部中的格式版本和记录对齐读写，与配置不同时不转换（见 UpgradeQueue）
+        format_ = ResolveRecordFormat(header_->version, header_->record_alignment);
+        if (format_version_ != 0 && format_version_ != header_->version) {
+            logger_->warn("Queue file uses format version {} instead of the configured version {}",
+                          header_->version, format_version_);
+        }
+        if (record_alignment_ != header_->record_alignment) {
+            logger_->warn("Queue file uses record alignment {} instead of the configured alignment {}",
+                          header_->record_alignment, record_alignment_);
         }
 
+        // 已有文件以头部记录的块大小为准，配置的块大小只用于新文件（调整见 ReblockQueue）
+        if (!IsValidBlockSize(header_->block_size)) {
+            throw std::runtime_error("Invalid block size");
+        }
         if (header_->block_size != block_size_) {
-            throw std::runtime_error("Block size mismatch");
+            logger_->info("Queue file uses block size {} instead of the configured block size {}",
+                          header_->block_size, block_size_);
+            block_size_ = header_->block_size;
         }
 
         // 验证队列状态
@@ -324,74 +1053,671 @@ private:
             throw std::runtime_error("Invalid queue size");
         }
 
-        if (header_->read_pos >= header_->capacity || header_->write_pos >= header_->capacity) {
+        if (HeaderReadPos(*header_) >= header_->capacity || HeaderWritePos(*header_) >= header_->capacity) {
             throw std::runtime_error("Invalid read/write positions");
         }
 
-        // 验证数据完整性
-        VerifyDataIntegrity();
-    }
+        // 校验条带配置，并确认每个条带文件都完整存在
+        if (std::max<uint64_t>(header_->stripe_count, 1) != file_handles_.size()) {
+            throw std::runtime_error("Stripe count mismatch");
+        }
+        for (size_t stripe = 1; stripe < file_handles_.size(); ++stripe) {
+            if (GetFileSize(file_handles_[stripe]) < StripeFileSize(header_->capacity, stripe)) {
+                throw std::runtime_error("Stripe file is missing or truncated: " + file_paths_[stripe]);
+            }
+        }
+
+        // 校验优先级通道配置和各通道状态
+        if (std::max<uint64_t>(header_->lane_count, 1) != lane_count_) {
+            throw std::runtime_error("Priority lane count mismatch");
+        }
+        if (lane_count_ > 1) {
+            uint64_t total_size = 0;
+            uint64_t total_count = 0;
+            for (size_t lane = 0; lane < lane_count_; ++lane) {
+                const LaneHeader& state = header_->lanes[lane];
+                if (state.begin < block_size_ || state.begin >= state.end || state.end > header_->capacity ||
+                    state.read_pos < state.begin || state.read_pos >= state.end ||
+                    state.write_pos < state.begin || state.write_pos >= state.end ||
+                    state.size > state.end - state.begin) {
+                    throw std::runtime_error("Invalid priority lane state");
+                }
+                total_size += state.size;
+                total_count += state.count;
+            }
+            if (total_size != header_->size || total_count != header_->count) {
+                throw std::runtime_error("Invalid priority lane state");
+            }
+        }
 
-    void VerifyDataIntegrity() {
-        if (header_->size == 0) {
-            return;  // 空队列，无需验证
+        // 为数据块预留连续的地址空间
+        ReserveAddressSpace(header_->max_size);
+
+        // 验证数据完整性；延迟打开时跳过，记录在出队时校验，损坏按数据损坏处理策略处理
+        if (!lazy_open_) {
+            for (size_t lane = 0; lane < lane_count_; ++lane) {
+                VerifyDataIntegrity(lane);
+            }
         }
+    }
 
-        size_t current_pos = header_->read_pos;
-        size_t remaining_size = header_->size;
+    void VerifyDataIntegrity(size_t lane) {
+        Ring ring = GetRing(lane);
+        uint64_t current_pos = ring.read_pos;
+        uint64_t remaining_size = ring.size;
 
         while (remaining_size > 0) {
-            // 确保当前块已映射
-            EnsureBlockMapped(current_pos / block_size_);
+            // 跳过区域末尾的回绕填充
+            uint64_t padding = 0;
+            const uint64_t start = ResolveRecordStart(ring, current_pos, padding);
 
             // 读取数据大小
+            EnsureRangeMapped(start, sizeof(uint32_t));
             uint32_t data_size;
-            std::memcpy(&data_size, GetBlockPtr(current_pos), sizeof(uint32_t));
+            std::memcpy(&data_size, GetBlockPtr(start), sizeof(uint32_t));
 
             // 计算总大小
-            const size_t total_size = sizeof(uint32_t) + data_size + sizeof(std::byte);
+            const size_t total_size = format_.RecordSize(data_size);
 
-            if (total_size > remaining_size) {
+            if (padding + total_size > remaining_size) {
                 throw std::runtime_error("Data corruption: invalid data size");
             }
+            EnsureRangeMapped(start, total_size);
 
             // 验证校验和
-            std::byte stored_checksum = *(GetBlockPtr(current_pos + sizeof(uint32_t) + data_size));
-            std::byte calculated_checksum = CalculateChecksum(
-                GetBlockPtr(current_pos + sizeof(uint32_t)),
-                data_size
-            );
-
-            if (stored_checksum != calculated_checksum) {
+            if (!format_.VerifyChecksum(GetBlockPtr(start + sizeof(uint32_t)), data_size)) {
                 throw std::runtime_error("Data corruption: checksum mismatch");
             }
 
             // 移动到下一个数据项
-            current_pos = (current_pos + total_size) % header_->capacity;
-            remaining_size -= total_size;
+            current_pos = RingAdvance(ring, start, total_size);
+            remaining_size -= padding + total_size;
+        }
+    }
+
+    // 读取指定通道的队首记录，consume 为 false 时不移动读取位置（损坏记录仍按策略处理）。
+    // 通道为空（或因损坏处理变空）时返回空
+    std::optional<std::vector<std::byte>> ReadFront(size_t lane, bool consume) {
+        auto front = LocateFront(lane);
+        if (!front) {
+            return std::nullopt;
+        }
+        std::vector<std::byte> data(front->data, front->data + front->data_size);
+        if (!consume) {
+            return data;
+        }
+
+        // 更新队列状态
+        const uint64_t previous_pos = GetRing(lane).read_pos;
+        ConsumeFront(lane, *front);
+        FlushHeader();
+        ReleaseConsumed(GetRing(lane), previous_pos, GetRing(lane).read_pos);
+
+        logger_->debug("Data dequeued successfully, remaining size: {}, count: {}", 
+                      header_->size, header_->count);
+        return data;
+    }
+
+    // 映射中已校验的队首记录
+    struct FrontRecord {
+        uint64_t start;         // 记录起始位置（越过回绕填充之后）
+        uint64_t consumed;      // 出队时释放的字节数（包括回绕填充）
+        const std::byte* data;  // 记录数据在映射中的位置
+        uint32_t data_size;
+    };
+
+    // 定位并校验指定通道的队首记录，不复制数据；损坏记录按策略处理后继续定位下一条。
+    // 通道为空（或因损坏处理变空）时返回空
+    std::optional<FrontRecord> LocateFront(size_t lane) {
+        Ring ring = GetRing(lane);
+        LaneRuntime& runtime = lanes_[lane];
+        while (ring.count > 0) {
+            // 跳过区域末尾的回绕填充
+            uint64_t padding = 0;
+            const uint64_t start = ResolveRecordStart(ring, ring.read_pos, padding);
+
+            // 读取数据大小
+            EnsureRangeMapped(start, sizeof(uint32_t));
+            uint32_t data_size;
+            std::memcpy(&data_size, GetBlockPtr(start), sizeof(uint32_t));
+
+            // 计算总大小（数据大小 + 大小字段 + 校验和），出队时连同填充一起释放
+            const size_t total_size = format_.RecordSize(data_size);
+            const uint64_t consumed = padding + total_size;
+            if (consumed > ring.size) {
+                // 长度字段损坏，无法定位下一条记录
+                HandleFramingCorruption(lane);
+                break;
+            }
+            EnsureRangeMapped(start, total_size);
+            const std::byte* data = GetBlockPtr(start + sizeof(uint32_t));
+
+            // 验证校验和（已被后台巡检校验过的记录可以跳过）
+            if (runtime.verified_bytes < consumed) {
+                if (!format_.VerifyChecksum(data, data_size)) {
+                    // 按策略处理损坏记录，跳过后继续读取下一条
+                    HandleCorruptRecord(lane, start, data, data_size, consumed);
+                    continue;
+                }
+                runtime.verified_bytes = 0;
+            }
+            return FrontRecord{start, consumed, data, data_size};
+        }
+        return std::nullopt;
+    }
+
+    // 在内存中把读取位置移过队首记录，由调用方刷新头部并释放已消费的块
+    void ConsumeFront(size_t lane, const FrontRecord& front) {
+        Ring ring = GetRing(lane);
+        LaneRuntime& runtime = lanes_[lane];
+        runtime.verified_bytes = runtime.verified_bytes >= front.consumed ? runtime.verified_bytes - front.consumed : 0;
+        runtime.consumed_bytes += front.consumed;
+        ring.read_pos = RingAdvance(ring, front.start, format_.RecordSize(front.data_size));
+        RemoveUsage(ring, front.consumed, 1);
+    }
+
+    void AdvanceReadPosition(size_t lane, uint64_t next_pos, uint64_t consumed) {
+        Ring ring = GetRing(lane);
+        const uint64_t previous_pos = ring.read_pos;
+        lanes_[lane].consumed_bytes += consumed;
+        ring.read_pos = next_pos;
+        RemoveUsage(ring, consumed, 1);  // 减少数据项计数
+
+        // 更新头部信息，读取位置持久化之后才释放已消费的块
+        FlushHeader();
+        ReleaseConsumed(ring, previous_pos, next_pos);
+    }
+
+    void HandleCorruptRecord(size_t lane, uint64_t offset, const std::byte* data, uint32_t data_size,
+                             uint64_t consumed) {
+        ReportCorruptRecord(offset, data, data_size);
+
+        lanes_[lane].verified_bytes = 0;
+        const size_t total_size = format_.RecordSize(data_size);
+        AdvanceReadPosition(lane, RingAdvance(GetRing(lane), offset, total_size), consumed);
+        corruption_stats_.skipped++;
+        logger_->error("Skipped corrupted record at offset: {}, size: {}", offset, total_size);
+    }
+
+    // 按策略记录一条校验失败的记录：抛出异常或写入隔离文件（数据连同存储的校验和），由调用方负责跳过
+    void ReportCorruptRecord(uint64_t offset, const std::byte* data, uint32_t data_size) {
+        corruption_stats_.detected++;
+        if (corruption_policy_ == CorruptionPolicy::kThrow) {
+            spdlog::error("Data corruption detected: checksum mismatch");
+            throw std::runtime_error("Data corruption detected: checksum mismatch");
+        }
+
+        if (corruption_policy_ == CorruptionPolicy::kQuarantine) {
+            // 先持久化到隔离文件，再跳过记录，保证损坏数据不会丢失
+            WriteQuarantine(offset, std::vector<std::byte>(data, data + data_size + format_.checksum_size));
+            corruption_stats_.quarantined++;
+        }
+    }
+
+    void HandleFramingCorruption(size_t lane) {
+        corruption_stats_.detected++;
+        if (corruption_policy_ == CorruptionPolicy::kThrow) {
+            spdlog::error("Data corruption detected: invalid data size");
+            throw std::runtime_error("Data corruption detected: invalid data size");
+        }
+
+        // 记录边界已丢失，通道中剩余数据只能整体丢弃（隔离模式下按原始字节保存）
+        Ring ring = GetRing(lane);
+        const uint64_t offset = ring.read_pos;
+        const uint64_t discarded_size = ring.size;
+        const uint64_t discarded_count = ring.count;
+        if (corruption_policy_ == CorruptionPolicy::kQuarantine) {
+            std::vector<std::byte> raw;
+            raw.reserve(discarded_size);
+            uint64_t pos = ring.read_pos;
+            uint64_t remaining = discarded_size;
+            while (remaining > 0) {
+                const size_t chunk = std::min<uint64_t>(remaining, ring.end - pos);
+                EnsureRangeMapped(pos, chunk);
+                const std::byte* src = GetBlockPtr(pos);
+                raw.insert(raw.end(), src, src + chunk);
+                pos = RingAdvance(ring, pos, chunk);
+                remaining -= chunk;
+            }
+            WriteQuarantine(offset, raw);
+            corruption_stats_.quarantined += discarded_count;
+        }
+
+        ring.read_pos = ring.write_pos;
+        RemoveUsage(ring, discarded_size, discarded_count);
+        FlushHeader();
+        lanes_[lane].verified_bytes = 0;
+        scrub_epoch_++;
+        corruption_stats_.skipped += discarded_count;
+        logger_->error("Discarded {} records after invalid data size at offset: {}", discarded_count, offset);
+    }
+
+    // 隔离文件条目格式：偏移量(uint64) + 长度(uint32) + 原始记录字节
+    void WriteQuarantine(uint64_t offset, const std::vector<std::byte>& record) {
+        std::FILE* file = std::fopen(quarantine_path_.c_str(), "ab");
+        if (file == nullptr) {
+            throw std::runtime_error("Failed to open quarantine file");
+        }
+        const uint32_t record_size = static_cast<uint32_t>(record.size());
+        bool ok = std::fwrite(&offset, sizeof(offset), 1, file) == 1 &&
+                  std::fwrite(&record_size, sizeof(record_size), 1, file) == 1 &&
+                  std::fwrite(record.data(), 1, record.size(), file) == record.size() &&
+                  std::fflush(file) == 0;
+#ifdef _WIN32
+        ok = ok && _commit(_fileno(file)) == 0;
+#else
+        ok = ok && fsync(fileno(file)) == 0;
+#endif
+        std::fclose(file);
+        if (!ok) {
+            throw std::runtime_error("Failed to write quarantine file");
+        }
+    }
+
+    void CheckPriority(size_t priority) const {
+        if (priority >= lane_count_) {
+            throw std::out_of_range("Invalid priority");
+        }
+    }
+
+    Ring GetRing(size_t lane) {
+        if (lane_count_ == 1) {
+            return {HeaderReadPos(*header_), HeaderWritePos(*header_), header_->size, header_->count, block_size_,
+                    header_->capacity};
+        }
+        LaneHeader& state = header_->lanes[lane];
+        return {state.read_pos, state.write_pos, state.size, state.count, state.begin, state.end};
+    }
+
+    // 多通道时同时维护头部中的汇总字段
+    void AddUsage(Ring& ring, uint64_t bytes, uint64_t items) {
+        ring.size += bytes;
+        ring.count += items;
+        if (lane_count_ > 1) {
+            header_->size += bytes;
+            header_->count += items;
+        }
+    }
+
+    void RemoveUsage(Ring& ring, uint64_t bytes, uint64_t items) {
+        ring.size -= bytes;
+        ring.count -= items;
+        if (lane_count_ > 1) {
+            header_->size -= bytes;
+            header_->count -= items;
+        }
+    }
+
+    // 在区域内前进 length 字节，越过区域末尾时回绕到区域起始位置
+    static uint64_t RingAdvance(const Ring& ring, uint64_t pos, uint64_t length) {
+        pos += length;
+        return pos >= ring.end ? ring.begin + (pos - ring.end) : pos;
+    }
+
+    // 返回 pos 处记录的实际起始位置：区域末尾放不下长度字段或遇到回绕标记时回绕到区域起始位置，
+    // padding 返回被跳过的字节数
+    uint64_t ResolveRecordStart(const Ring& ring, uint64_t pos, uint64_t& padding) {
+        padding = 0;
+        if (pos + sizeof(uint32_t) <= ring.end) {
+            EnsureRangeMapped(pos, sizeof(uint32_t));
+            uint32_t marker;
+            std::memcpy(&marker, GetBlockPtr(pos), sizeof(uint32_t));
+            if (marker != WRAP_MARKER) {
+                return pos;
+            }
+        }
+        padding = ring.end - pos;
+        return ring.begin;
+    }
+
+    // 写入位置到区域末尾放不下记录时，需要跳过的填充字节数
+    static uint64_t WrapPadding(const Ring& ring, size_t total_size) {
+        return ring.write_pos + total_size > ring.end ? ring.end - ring.write_pos : 0;
+    }
+
+    static bool HasSpace(const Ring& ring, size_t total_size) {
+        const uint64_t region_size = ring.end - ring.begin;
+        return total_size <= region_size && ring.size + WrapPadding(ring, total_size) + total_size <= region_size;
+    }
+
+    // 只有单通道且未回绕时才能扩展文件：回绕后扩展会在已有数据中间插入新空间
+    bool CanExpand() const {
+        return lane_count_ == 1 && header_->capacity < header_->max_size &&
+               (header_->size == 0 || HeaderWritePos(*header_) > HeaderReadPos(*header_));
+    }
+
+    // 空间不足时需要扩展文件；文件可以扩展时优先扩展而不是回绕，
+    // 使按需增长的文件在达到最大大小之前保持未回绕状态，回绕后就无法再扩展
+    bool NeedsExpand(const Ring& ring, size_t total_size) const {
+        return !HasSpace(ring, total_size) || (CanExpand() && ring.write_pos + total_size >= ring.end);
+    }
+
+    // 写入一条记录，空间不足时尝试扩展文件；调用方负责刷新头部
+    bool AppendRecord(const std::vector<std::byte>& data, size_t lane) {
+        // 计算需要写入的总大小（数据大小 + 大小字段 + 校验和 + 对齐填充）
+        const size_t total_size = format_.RecordSize(data.size());
+        
+        // 检查是否有足够的空间，空间不足时尝试扩展文件
+        while (NeedsExpand(GetRing(lane), total_size)) {
+            DiscardStaged();
+            if (!CanExpand()) {
+                MarkFull();
+                spdlog::warn("Queue is full");
+                return false;
+            }
+            ExpandFile();
+        }
+
+        Ring ring = GetRing(lane);
+        WriteRecord(ring, data, total_size);
+        return true;
+    }
+
+    // 将到期的延迟记录转入通道 0，先刷新头部再持久化延迟存储的转出进度，返回转入的记录数
+    size_t PromoteDueRecords() {
+        const int64_t now = NowNanoseconds();
+        if (!delayed_->HasDue(now)) {
+            return 0;
+        }
+        const size_t promoted = delayed_->PromoteDue(
+            now, [this](const std::vector<std::byte>& data) { return AppendRecord(data, 0); },
+            [this] { FlushHeader(); });
+        if (promoted > 0) {
+            logger_->debug("Promoted {} delayed records", promoted);
+        }
+        return promoted;
+    }
+
+    // 投递定时线程：有延迟记录时启动，在最早的投递时间到达时转入到期记录，
+    // 使 DataAvailableFd 和数据通知回调不依赖消费者调用 Dequeue/Peek。调用方持有 mutex_
+    void StartDeliveryTimer() {
+        {
+            std::scoped_lock lock(delivery_mutex_);
+            delivery_wakeup_ = true;
+        }
+        delivery_cv_.notify_all();
+        if (!delivery_.joinable()) {
+            delivery_ = std::thread([this] { DeliveryLoop(); });
+        }
+    }
+
+    void StopDeliveryTimer() {
+        if (!delivery_.joinable()) {
+            return;
+        }
+        {
+            std::scoped_lock lock(delivery_mutex_);
+            delivery_stop_ = true;
+        }
+        delivery_cv_.notify_all();
+        delivery_.join();
+    }
+
+    void DeliveryLoop() {
+        while (true) {
+            size_t promoted = 0;
+            std::optional<int64_t> next_due;
+            {
+                std::scoped_lock lock(mutex_);
+                try {
+                    promoted = PromoteDueRecords();
+                } catch (const std::exception& e) {
+                    logger_->error("Failed to promote delayed records: {}", e.what());
+                }
+                next_due = delayed_->NextDue();
+            }
+            if (promoted > 0) {
+                NotifyDataAvailable();
+            }
+
+            // 等到最早的投递时间；到期记录因队列已满未能转入时按重试间隔等待，
+            // 等待时间有上限以应对系统时钟跳变
+            auto wait = MAX_DELIVERY_WAIT;
+            if (next_due) {
+                const auto until_due = std::chrono::nanoseconds(*next_due - NowNanoseconds());
+                wait = until_due.count() <= 0 ? DELIVERY_RETRY_INTERVAL : std::min(until_due, MAX_DELIVERY_WAIT);
+            }
+            std::unique_lock lock(delivery_mutex_);
+            delivery_cv_.wait_for(lock, wait, [this] { return delivery_stop_ || delivery_wakeup_; });
+            if (delivery_stop_) {
+                return;
+            }
+            delivery_wakeup_ = false;
+        }
+    }
+
+    static int64_t NowNanoseconds() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::system_clock::now().time_since_epoch())
+            .count();
+    }
+
+    void WriteRecord(Ring& ring, const std::vector<std::byte>& data, size_t total_size) {
+        const uint64_t start = ring.write_pos;
+        const uint64_t used = StageRecord(ring, data, total_size);
+
+        // 确保数据写入磁盘
+        FlushRingRange(ring, start, ring.write_pos);
+        
+        // 更新队列状态
+        AddUsage(ring, used, 1);  // 增加数据项计数
+        CountRecordSize(data.size());
+    }
+
+    // 把记录大小计入头部中的大小分布，随下一次头部刷新持久化
+    void CountRecordSize(size_t size) {
+        size_t bucket = 0;
+        while (bucket + 1 < RecordSizeStats::BUCKETS && size >> (bucket + 1) != 0) {
+            bucket++;
+        }
+        header_->record_sizes[bucket]++;
+    }
+
+    // 在写入位置写入一条记录并前进写入位置，不刷盘也不更新占用统计，返回占用的字节数（含回绕填充）
+    uint64_t StageRecord(Ring& ring, const std::vector<std::byte>& data, size_t total_size) {
+        const uint64_t padding = WrapPadding(ring, total_size);
+        if (padding > 0) {
+            // 区域末尾剩余空间不足，写入回绕标记后从区域起始位置继续写入
+            if (padding >= sizeof(uint32_t)) {
+                StoreBytes(ring.write_pos, &WRAP_MARKER, sizeof(uint32_t));
+            }
+            ring.write_pos = ring.begin;
+        }
+
+        // 写入数据大小
+        uint32_t data_size = static_cast<uint32_t>(data.size());
+        StoreBytes(ring.write_pos, &data_size, sizeof(uint32_t));
+
+        // 写入实际数据
+        StoreBytes(ring.write_pos + sizeof(uint32_t), data.data(), data.size());
+
+        // 计算并写入校验和，之后以零填充到记录对齐，使写入保持连续
+        std::byte trailer[sizeof(uint32_t) + MAX_RECORD_ALIGNMENT]{};
+        format_.WriteChecksum(data.data(), data.size(), trailer);
+        StoreBytes(ring.write_pos + sizeof(uint32_t) + data.size(), trailer, total_size - sizeof(uint32_t) - data.size());
+
+        ring.write_pos = RingAdvance(ring, ring.write_pos, total_size);
+        return padding + total_size;
+    }
+
+    // 写入数据区：直接 I/O 模式下暂存到对齐缓冲区，否则写入映射
+    void StoreBytes(uint64_t offset, const void* data, size_t length) {
+        if (direct_ != nullptr) {
+            direct_->Stage(offset, data, length);
+            return;
+        }
+        EnsureRangeMapped(offset, length);
+        std::memcpy(GetBlockPtr(offset), data, length);
+    }
+
+    // 丢弃直接 I/O 模式下尚未写出的暂存数据，避免之后不连续的写入把它们连同填充写到未消费的记录上
+    void DiscardStaged() {
+        if (direct_ != nullptr) {
+            direct_->Discard();
+        }
+    }
+
+    // 刷新区域内 [from, to) 的数据，to 不大于 from 时表示跨越了区域末尾
+    void FlushRingRange(const Ring& ring, uint64_t from, uint64_t to) {
+        if (direct_ != nullptr) {
+            // 读取位置位于 to 所在页中 to 之后时，该页剩余部分是未消费的数据，写出时需要保留
+            const uint64_t page_end = (to / DirectWriter::ALIGNMENT + 1) * DirectWriter::ALIGNMENT;
+            direct_->Flush(ring.size > 0 && ring.read_pos >= to && ring.read_pos < page_end);
+            return;
+        }
+        if (to > from) {
+            FlushRange(from, to - from);
+            return;
+        }
+        FlushRange(from, ring.end - from);
+        FlushRange(ring.begin, to - ring.begin);
+    }
+
+    // 选择出队通道：优先级高的通道优先；设置了饥饿上限时，低优先级通道在被连续跳过
+    // starvation_limit_ 次后获得一次出队机会
+    size_t SelectLane(bool consume) {
+        size_t highest = lane_count_;
+        size_t lower = lane_count_;
+        for (size_t lane = lane_count_; lane-- > 0;) {
+            if (GetRing(lane).count == 0) {
+                continue;
+            }
+            if (highest == lane_count_) {
+                highest = lane;
+            } else {
+                lower = lane;
+                break;
+            }
+        }
+        if (lower == lane_count_) {
+            if (consume) {
+                bypassed_ = 0;
+            }
+            return highest == lane_count_ ? 0 : highest;
+        }
+        if (starvation_limit_ > 0 && bypassed_ >= starvation_limit_) {
+            if (consume) {
+                bypassed_ = 0;
+            }
+            return lower;
+        }
+        if (consume) {
+            bypassed_++;
+        }
+        return highest;
+    }
+
+    // 查找生产者所在的槽，不存在时返回探测序列中的第一个空槽，表已满时返回 nullptr
+    ProducerEntry* FindProducer(uint64_t producer_id) const {
+        const size_t start = std::hash<uint64_t>{}(producer_id) % MAX_PRODUCERS;
+        for (size_t i = 0; i < MAX_PRODUCERS; ++i) {
+            ProducerEntry& entry = header_->producers[(start + i) % MAX_PRODUCERS];
+            if (entry.producer_id == producer_id || entry.producer_id == 0) {
+                return &entry;
+            }
+        }
+        return nullptr;
+    }
+
+    // 删除槽位并把其后探测序列中的生产者前移填补空位，保证 FindProducer 的探测不会提前遇到空槽
+    void EraseProducer(size_t hole) {
+        header_->producers[hole] = {};
+        for (size_t step = 1; step < MAX_PRODUCERS; ++step) {
+            const size_t slot = (hole + step) % MAX_PRODUCERS;
+            ProducerEntry& entry = header_->producers[slot];
+            if (entry.producer_id == 0) {
+                break;
+            }
+            // 生产者的起始槽不在 (hole, slot] 之间时才能前移到空位
+            const size_t home = std::hash<uint64_t>{}(entry.producer_id) % MAX_PRODUCERS;
+            if ((slot + MAX_PRODUCERS - home) % MAX_PRODUCERS >= (slot + MAX_PRODUCERS - hole) % MAX_PRODUCERS) {
+                header_->producers[hole] = entry;
+                entry = {};
+                hole = slot;
+                step = 0;
+            }
+        }
+    }
+
+    // 租约模式下选择有未投递记录的最高优先级通道，没有时返回 lane_count_
+    size_t SelectLeaseLane() {
+        for (size_t lane = lane_count_; lane-- > 0;) {
+            const LaneRuntime& runtime = lanes_[lane];
+            if (GetRing(lane).count > runtime.next_seq - runtime.base_seq) {
+                return lane;
+            }
+        }
+        return lane_count_;
+    }
+
+    static uint64_t MakeLeaseId(size_t lane, uint64_t seq, uint64_t generation) {
+        return (static_cast<uint64_t>(lane) << LEASE_LANE_SHIFT) |
+               ((generation & LEASE_GENERATION_MASK) << LEASE_GENERATION_SHIFT) | seq;
+    }
+
+    bool IsAcked(size_t lane, uint64_t seq) const {
+        const LaneRuntime& runtime = lanes_[lane];
+        if (seq < runtime.base_seq) {
+            return true;
+        }
+        const uint64_t bit = seq - runtime.acked_base;
+        return (runtime.acked[bit / 64] >> (bit % 64)) & 1;
+    }
+
+    void MarkAcked(size_t lane, uint64_t seq) {
+        LaneRuntime& runtime = lanes_[lane];
+        const uint64_t bit = seq - runtime.acked_base;
+        runtime.acked[bit / 64] |= 1ULL << (bit % 64);
+    }
+
+    // 读取位置越过从 base_seq 开始连续已确认的记录，最后统一刷新头部
+    void CommitAcked(size_t lane) {
+        Ring ring = GetRing(lane);
+        LaneRuntime& runtime = lanes_[lane];
+        const uint64_t previous_pos = ring.read_pos;
+        bool advanced = false;
+        while (runtime.base_seq < runtime.next_seq && IsAcked(lane, runtime.base_seq)) {
+            uint64_t padding = 0;
+            const uint64_t start = ResolveRecordStart(ring, ring.read_pos, padding);
+            EnsureRangeMapped(start, sizeof(uint32_t));
+            uint32_t data_size;
+            std::memcpy(&data_size, GetBlockPtr(start), sizeof(uint32_t));
+            const size_t total_size = format_.RecordSize(data_size);
+            const uint64_t consumed = padding + total_size;
+
+            ring.read_pos = RingAdvance(ring, start, total_size);
+            RemoveUsage(ring, consumed, 1);
+            runtime.consumed_bytes += consumed;
+            runtime.verified_bytes = runtime.verified_bytes >= consumed ? runtime.verified_bytes - consumed : 0;
+            runtime.base_seq++;
+            runtime.generations.pop_front();
+            if (runtime.base_seq - runtime.acked_base >= 64) {
+                runtime.acked.pop_front();
+                runtime.acked_base += 64;
+            }
+            advanced = true;
+        }
+        if (advanced) {
+            FlushHeader();
+            ReleaseConsumed(ring, previous_pos, ring.read_pos);
         }
     }
 
-    bool CanRecycleSpace(size_t required_size) {
-        // 检查是否有足够的可回收空间
-        if (header_->read_pos > block_size_) {
-            // 如果读取位置不在文件开头，说明有可回收空间
-            return true;
-        }
-        
-        // 检查写入位置是否已经绕回
-        if (header_->write_pos < header_->read_pos) {
-            // 如果写入位置在读取位置之前，说明已经绕回
-            return (header_->read_pos - header_->write_pos) >= required_size;
-        }
-        
-        return false;
+    // 读取已校验过的记录（用于重新投递）
+    std::vector<std::byte> ReadRecordAt(uint64_t start) {
+        EnsureRangeMapped(start, sizeof(uint32_t));
+        uint32_t data_size;
+        std::memcpy(&data_size, GetBlockPtr(start), sizeof(uint32_t));
+        EnsureRangeMapped(start, sizeof(uint32_t) + data_size);
+        std::vector<std::byte> data(data_size);
+        std::memcpy(data.data(), GetBlockPtr(start + sizeof(uint32_t)), data_size);
+        return data;
     }
 
-    void UpdateReadPosition() {
-        // 更新读取位置到文件开头
-        header_->read_pos = block_size_;
-        FlushHeader();
+    void CheckNoLeases() const {
+        if (leased_count_ > 0) {
+            throw std::logic_error("Records are leased, use Receive and Ack");
+        }
     }
 
     void ExpandFile() {
@@ -399,17 +1725,17 @@ private:
         size_t new_size = std::min(header_->capacity * 2, header_->max_size);
         
         // 调整文件大小
-        ResizeFile(new_size);
+        ResizeStripes(new_size);
         
         // 更新容量
         header_->capacity = new_size;
         FlushHeader();
     }
 
-    void OpenFile() {
+    FileHandle OpenFile(const std::string& path) {
 #ifdef _WIN32
-        file_handle_ = CreateFileA(
-            file_path_.c_str(),
+        FileHandle handle = CreateFileA(
+            path.c_str(),
             GENERIC_READ | GENERIC_WRITE,
             FILE_SHARE_READ | FILE_SHARE_WRITE,
             nullptr,
@@ -417,63 +1743,461 @@ private:
             FILE_ATTRIBUTE_NORMAL,
             nullptr
         );
-        if (file_handle_ == InvalidHandle) {
+        if (handle == InvalidHandle) {
             throw std::runtime_error("Failed to open queue file");
         }
 #else
-        file_handle_ = open(file_path_.c_str(), O_RDWR | O_CREAT, 0644);
-        if (file_handle_ == InvalidHandle) {
+        FileHandle handle = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (handle == InvalidHandle) {
             throw std::runtime_error("Failed to open queue file");
         }
+#endif
+        return handle;
+    }
+
+    // 创建纯内存模式使用的匿名内存文件（仅 Linux）。块以 MAP_SHARED 映射，fork 后父子进程看到同一份数据
+    FileHandle CreateMemoryFile(const std::string& path) {
+#ifdef __linux__
+        FileHandle handle = memfd_create(fs::path(path).filename().c_str(), MFD_CLOEXEC);
+        if (handle == InvalidHandle) {
+            throw std::runtime_error("Failed to create memory file");
+        }
+        return handle;
+#else
+        (void)path;
+        throw std::runtime_error("Memory-only queues are not supported on this platform");
 #endif
     }
 
-    void CloseFile() {
+    void CloseFile(FileHandle handle) {
 #ifdef _WIN32
-        CloseHandle(file_handle_);
+        CloseHandle(handle);
 #else
-        close(file_handle_);
+        close(handle);
 #endif
     }
 
-    size_t GetFileSize() {
+    size_t GetFileSize(FileHandle handle) {
 #ifdef _WIN32
         LARGE_INTEGER size;
-        if (!GetFileSizeEx(file_handle_, &size)) {
+        if (!GetFileSizeEx(handle, &size)) {
             throw std::runtime_error("Failed to get file size");
         }
         return static_cast<size_t>(size.QuadPart);
 #else
         struct stat st;
-        if (fstat(file_handle_, &st) == -1) {
+        if (fstat(handle, &st) == -1) {
             throw std::runtime_error("Failed to get file size");
         }
         return static_cast<size_t>(st.st_size);
 #endif
     }
 
-    void ResizeFile(size_t new_size) {
+    void ResizeFile(FileHandle handle, size_t new_size) {
 #ifdef _WIN32
         LARGE_INTEGER size;
         size.QuadPart = new_size;
-        if (!SetFilePointerEx(file_handle_, size, nullptr, FILE_BEGIN) ||
-            !SetEndOfFile(file_handle_)) {
+        if (!SetFilePointerEx(handle, size, nullptr, FILE_BEGIN) ||
+            !SetEndOfFile(handle)) {
             throw std::runtime_error("Failed to resize file");
         }
 #else
-        if (ftruncate(file_handle_, new_size) == -1) {
+        if (ftruncate(handle, new_size) == -1) {
             throw std::runtime_error("Failed to resize file");
         }
 #endif
     }
 
+    // 按 Compact 调用时观察到的头部刷新次数判断空闲时长，读写路径上只递增计数，不读取时钟
+    bool IdleFor(std::chrono::milliseconds duration) {
+        const auto now = std::chrono::steady_clock::now();
+        if (activity_ != observed_activity_) {
+            observed_activity_ = activity_;
+            idle_since_ = now;
+        }
+        return now - idle_since_ >= duration;
+    }
+
+    // 读取位置从 from 前进到 to 时，释放越过的块：打洞，直接 I/O 模式下还从页缓存中丢弃。
+    // 这些块中 to 之前的数据都已消费，只需排除写入位置回绕后正在写入的块。
+    // 读取位置每次前进只比较块号，越过块边界时才产生系统调用
+    void ReleaseConsumed(const Ring& ring, uint64_t from, uint64_t to) {
+        const size_t to_block = to / block_size_;
+        if ((!punch_consumed_blocks_ && direct_ == nullptr) || from / block_size_ == to_block) {
+            return;
+        }
+        const size_t write_block = ring.write_pos / block_size_;
+        const bool write_block_used = ring.write_pos % block_size_ != 0;
+        for (size_t block_index = from / block_size_; block_index != to_block;) {
+            if (block_index != write_block || !write_block_used) {
+                if (punch_consumed_blocks_) {
+                    PunchBlock(block_index);
+                }
+                if (direct_ != nullptr) {
+                    DropCachedBlock(block_index);
+                }
+            }
+            block_index = (block_index + 1) * block_size_ >= ring.end ? ring.begin / block_size_ : block_index + 1;
+        }
+    }
+
+    // 从页缓存中丢弃已消费的块，避免读取路径把数据留在页缓存中
+    void DropCachedBlock(size_t block_index) {
+#ifdef __linux__
+        auto it = mapped_blocks_.find(block_index);
+        if (it != mapped_blocks_.end()) {
+            madvise(it->second.data, block_size_, MADV_DONTNEED);
+        }
+        const size_t stripes = file_handles_.size();
+        posix_fadvise(file_handles_[block_index % stripes], static_cast<off_t>(block_index / stripes * block_size_),
+                      static_cast<off_t>(block_size_), POSIX_FADV_DONTNEED);
+#else
+        (void)block_index;
+#endif
+    }
+
+    void PunchBlock(size_t block_index) {
+#ifdef __linux__
+        const size_t stripes = file_handles_.size();
+        const off_t file_offset = static_cast<off_t>(block_index / stripes * block_size_);
+        if (fallocate(file_handles_[block_index % stripes], FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, file_offset,
+                      static_cast<off_t>(block_size_)) == -1) {
+            // 文件系统不支持打洞时不再尝试
+            logger_->warn("Failed to punch hole in block {}, disabling hole punching", block_index);
+            punch_consumed_blocks_ = false;
+        }
+#else
+        (void)block_index;
+        punch_consumed_blocks_ = false;
+#endif
+    }
+
+    // 在写入位置写入回绕标记并把写入位置移到区域起始位置，标记之后到区域末尾的空间计为填充，
+    // 读取位置越过它时一并释放
+    void WrapEarly(Ring& ring) {
+        const uint64_t padding = ring.end - ring.write_pos;
+        if (padding >= sizeof(uint32_t)) {
+            StoreBytes(ring.write_pos, &WRAP_MARKER, sizeof(uint32_t));
+            FlushRingRange(ring, ring.write_pos, ring.write_pos + sizeof(uint32_t));
+        }
+        logger_->info("Wrapping write position early at offset: {} for compaction", ring.write_pos);
+        ring.write_pos = ring.begin;
+        AddUsage(ring, padding, 0);
+        FlushHeader();
+    }
+
+    // 快照开始时在锁内记录的状态
+    struct SnapshotState {
+        QueueHeader header;
+        std::vector<uint64_t> consumed_bytes;  // 各通道的累计出队字节数
+        uint64_t epoch = 0;
+    };
+
+    static constexpr size_t SNAPSHOT_ATTEMPTS = 3;  // 锁外复制的尝试次数
+
+    SnapshotState CaptureSnapshotState() {
+        SnapshotState state;
+        std::memcpy(&state.header, header_, sizeof(QueueHeader));
+        for (const LaneRuntime& runtime : lanes_) {
+            state.consumed_bytes.push_back(runtime.consumed_bytes);
+        }
+        state.epoch = scrub_epoch_;
+        return state;
+    }
+
+    // 复制期间记录未被覆盖时快照有效：读取位置没有跳变、容量不变，生产者写入的位置没有追上快照的读取位置，
+    // 打洞时消费者也没有越过快照读取位置所在块的边界
+    bool SnapshotIntact(const SnapshotState& state) {
+        if (scrub_epoch_ != state.epoch || header_->capacity != state.header.capacity) {
+            return false;
+        }
+        for (size_t lane = 0; lane < lane_count_; ++lane) {
+            Ring ring = GetRing(lane);
+            const uint64_t consumed = lanes_[lane].consumed_bytes - state.consumed_bytes[lane];
+            const uint64_t read_pos = lane_count_ == 1 ? HeaderReadPos(state.header) : state.header.lanes[lane].read_pos;
+            if (consumed + ring.size > ring.end - ring.begin) {
+                return false;
+            }
+            if (punch_consumed_blocks_ && read_pos % block_size_ + consumed >= block_size_) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // 写出快照文件：单个文件，头部与快照状态一致，数据区只包含各通道读写位置之间的记录
+    void WriteSnapshot(const SnapshotState& state, int fd) {
+#ifndef _WIN32
+        QueueHeader header = state.header;
+        header.stripe_count = 1;
+        if (ftruncate(fd, 0) == -1 || ftruncate(fd, static_cast<off_t>(header.capacity)) == -1) {
+            throw std::runtime_error("Failed to resize snapshot file");
+        }
+        if (pwrite(fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header))) {
+            throw std::runtime_error("Failed to write snapshot header");
+        }
+        for (size_t lane = 0; lane < lane_count_; ++lane) {
+            const bool single = lane_count_ == 1;
+            const LaneHeader& state_lane = header.lanes[lane];
+            const uint64_t begin = single ? block_size_ : state_lane.begin;
+            const uint64_t end = single ? header.capacity : state_lane.end;
+            uint64_t pos = single ? HeaderReadPos(header) : state_lane.read_pos;
+            uint64_t remaining = single ? header.size : state_lane.size;
+            while (remaining > 0) {
+                // 按块拆分，每个块位于一个条带文件中
+                const uint64_t length = std::min({remaining, end - pos, block_size_ - pos % block_size_});
+                const size_t block_index = pos / block_size_;
+                const size_t stripes = file_handles_.size();
+                CopyBytes(file_handles_[block_index % stripes], block_index / stripes * block_size_ + pos % block_size_,
+                          fd, pos, length);
+                pos += length;
+                if (pos >= end) {
+                    pos = begin;
+                }
+                remaining -= length;
+            }
+        }
+#else
+        (void)state;
+        (void)fd;
+#endif
+    }
+
+    // 在文件之间复制数据：优先使用 copy_file_range（支持的文件系统上为 reflink），不支持时读写复制
+    static void CopyBytes(int in_fd, uint64_t in_offset, int out_fd, uint64_t out_offset, uint64_t length) {
+#ifndef _WIN32
+#ifdef __linux__
+        while (length > 0) {
+            auto in = static_cast<off_t>(in_offset);
+            auto out = static_cast<off_t>(out_offset);
+            const ssize_t copied = copy_file_range(in_fd, &in, out_fd, &out, length, 0);
+            if (copied <= 0) {
+                if (copied == -1 && errno == EINTR) {
+                    continue;
+                }
+                break;
+            }
+            in_offset += static_cast<uint64_t>(copied);
+            out_offset += static_cast<uint64_t>(copied);
+            length -= static_cast<uint64_t>(copied);
+        }
+#endif
+        std::vector<std::byte> buffer(std::min<uint64_t>(length, 1024 * 1024));
+        while (length > 0) {
+            const ssize_t bytes = pread(in_fd, buffer.data(), std::min<uint64_t>(length, buffer.size()),
+                                        static_cast<off_t>(in_offset));
+            if (bytes <= 0) {
+                if (bytes == -1 && errno == EINTR) {
+                    continue;
+                }
+                throw std::runtime_error("Failed to read queue file for snapshot");
+            }
+            size_t written = 0;
+            while (written < static_cast<size_t>(bytes)) {
+                const ssize_t result = pwrite(out_fd, buffer.data() + written, static_cast<size_t>(bytes) - written,
+                                              static_cast<off_t>(out_offset + written));
+                if (result == -1) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    throw std::runtime_error("Failed to write snapshot file");
+                }
+                written += static_cast<size_t>(result);
+            }
+            in_offset += static_cast<uint64_t>(bytes);
+            out_offset += static_cast<uint64_t>(bytes);
+            length -= static_cast<uint64_t>(bytes);
+        }
+#else
+        (void)in_fd;
+        (void)in_offset;
+        (void)out_fd;
+        (void)out_offset;
+        (void)length;
+#endif
+    }
+
+    // 排斥读取器：QueueReader 打开期间持有主文件的共享锁（flock），截断或重建文件前以非阻塞方式
+    // 取得排他锁，取不到时说明有读取器映射着文件。持有排他锁期间新的读取器在打开时等待
+    class ReaderExclusion {
+    public:
+        explicit ReaderExclusion(FileHandle handle) : handle_(handle) {
+#ifndef _WIN32
+            acquired_ = flock(handle_, LOCK_EX | LOCK_NB) == 0;
+#else
+            acquired_ = true;
+#endif
+        }
+
+        ~ReaderExclusion() {
+#ifndef _WIN32
+            if (acquired_) {
+                flock(handle_, LOCK_UN);
+            }
+#endif
+        }
+
+        ReaderExclusion(const ReaderExclusion&) = delete;
+        ReaderExclusion& operator=(const ReaderExclusion&) = delete;
+
+        bool Acquired() const {
+            return acquired_;
+        }
+
+    private:
+        FileHandle handle_;
+        bool acquired_;
+    };
+
+    // 未回绕时把文件收缩到写入位置所在的块为止；收缩后不足原容量一半时才执行，避免反复扩展和收缩。
+    // 巡检线程在锁外读取映射，运行期间不收缩；有 QueueReader 打开时也不收缩。返回释放的字节数
+    size_t ShrinkFile(const Ring& ring) {
+        if (scrubber_running_ || (ring.size > 0 && ring.write_pos <= ring.read_pos)) {
+            return 0;
+        }
+        const uint64_t new_capacity = std::max<uint64_t>(2 * block_size_, (ring.write_pos / block_size_ + 1) * block_size_);
+        const uint64_t old_capacity = header_->capacity;
+        if (new_capacity * 2 > old_capacity) {
+            return 0;
+        }
+        ReaderExclusion exclusion(file_handles_[0]);
+        if (!exclusion.Acquired()) {
+            logger_->debug("Queue readers attached, skip shrinking");
+            return 0;
+        }
+
+        // 先持久化新的容量再截断文件，截断前崩溃只会留下多余的文件尾部
+        header_->capacity = new_capacity;
+        FlushHeader();
+        for (auto it = mapped_blocks_.lower_bound(new_capacity / block_size_); it != mapped_blocks_.end();) {
+            UnmapBlock(it->second);
+            it = mapped_blocks_.erase(it);
+        }
+        ResizeStripes(new_capacity);
+        if (direct_ != nullptr) {
+            direct_->Invalidate();
+        }
+        logger_->info("Queue file shrunk from {} to {} bytes", old_capacity, new_capacity);
+        return old_capacity - new_capacity;
+    }
+
+    // 按记录大小分布为空队列重新选择块大小：解除所有块的映射，数据区从新的块大小处重新开始，
+    // 文件调整为两个新块。需要增大的条带文件先扩展再刷新头部，需要缩小的刷新头部后再截断，
+    // 任何时刻崩溃都不会出现头部容量超过文件大小。返回释放的字节数
+    size_t AdaptBlockSize() {
+        RecordSizeStats stats;
+        uint64_t records = 0;
+        for (size_t bucket = 0; bucket < RecordSizeStats::BUCKETS; ++bucket) {
+            stats.buckets[bucket] = header_->record_sizes[bucket];
+            records += stats.buckets[bucket];
+        }
+        if (scrubber_running_ || records < ADAPTIVE_MIN_RECORDS) {
+            return 0;
+        }
+        const size_t recommended = PersistentQueue::RecommendBlockSize(stats);
+        if (recommended * ADAPTIVE_BLOCK_RATIO > block_size_ && recommended < block_size_ * ADAPTIVE_BLOCK_RATIO) {
+            return 0;
+        }
+        // 读取器按打开时的块大小映射文件，有读取器时不重建
+        ReaderExclusion exclusion(file_handles_[0]);
+        if (!exclusion.Acquired()) {
+            logger_->debug("Queue readers attached, skip adapting block size");
+            return 0;
+        }
+
+        const size_t old_block_size = block_size_;
+        std::vector<size_t> old_sizes;
+        for (size_t stripe = 0; stripe < file_handles_.size(); ++stripe) {
+            old_sizes.push_back(StripeFileSize(header_->capacity, stripe));
+        }
+        for (const auto& [_, block] : mapped_blocks_) {
+            UnmapBlock(block);
+        }
+        mapped_blocks_.clear();
+
+        block_size_ = recommended;
+        const uint64_t new_capacity = 2 * block_size_;
+        size_t released = 0;
+        for (size_t stripe = 0; stripe < file_handles_.size(); ++stripe) {
+            const size_t new_size = StripeFileSize(new_capacity, stripe);
+            if (new_size > old_sizes[stripe]) {
+                ResizeFile(file_handles_[stripe], new_size);
+            } else {
+                released += old_sizes[stripe] - new_size;
+            }
+        }
+        header_->block_size = block_size_;
+        header_->head = block_size_;
+        header_->tail = block_size_;
+        HeaderReadPos(*header_) = block_size_;
+        HeaderWritePos(*header_) = block_size_;
+        header_->capacity = new_capacity;
+        FlushHeader();
+        ResizeStripes(new_capacity);
+        if (direct_ != nullptr) {
+            direct_ = std::make_unique<DirectWriter>(file_paths_, block_size_);
+        }
+        lanes_[0].verified_bytes = 0;
+        scrub_epoch_++;
+        logger_->info("Block size adapted from {} to {} for the observed record sizes", old_block_size, block_size_);
+        return released;
+    }
+
+    // 为块分配磁盘空间（不改变文件大小），使首次写入不再触发文件系统分配；不支持时忽略
+    void AllocateBlock(size_t block_index) {
+#ifdef __linux__
+        const size_t stripes = file_handles_.size();
+        const off_t file_offset = static_cast<off_t>(block_index / stripes * block_size_);
+        fallocate(file_handles_[block_index % stripes], FALLOC_FL_KEEP_SIZE, file_offset,
+                  static_cast<off_t>(block_size_));
+#else
+        (void)block_index;
+#endif
+    }
+
+    // 逻辑容量为 capacity 时第 stripe 个条带文件的大小：块 i 位于条带 i % n 的第 i / n 个块
+    size_t StripeFileSize(size_t capacity, size_t stripe) const {
+        const size_t stripes = file_handles_.size();
+        const size_t total_blocks = (capacity + block_size_ - 1) / block_size_;
+        return (total_blocks + stripes - 1 - stripe) / stripes * block_size_;
+    }
+
+    void ResizeStripes(size_t capacity) {
+        for (size_t stripe = 0; stripe < file_handles_.size(); ++stripe) {
+            ResizeFile(file_handles_[stripe], StripeFileSize(capacity, stripe));
+        }
+    }
+
+    // 预留与最大文件大小相同的地址空间，块按逻辑偏移映射到其中，
+    // 这样跨越块边界（以及跨越条带文件）的记录在内存中仍然是连续的
+    void ReserveAddressSpace(size_t size) {
+#ifndef _WIN32
+        void* base = mmap(nullptr, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (base == MAP_FAILED) {
+            throw std::runtime_error("Failed to reserve address space");
+        }
+        reserved_base_ = static_cast<std::byte*>(base);
+        reserved_size_ = size;
+#else
+        (void)size;
+#endif
+    }
+
+    void ReleaseAddressSpace() {
+#ifndef _WIN32
+        if (reserved_base_ != nullptr) {
+            munmap(reserved_base_, reserved_size_);
+            reserved_base_ = nullptr;
+        }
+#endif
+    }
+
     void MapHeaderBlock() {
-        // 头部块固定为4KB
-        const size_t header_block_size = 4096;
+        const size_t header_block_size = HEADER_BLOCK_SIZE;
         
 #ifdef _WIN32
         HANDLE mapping = CreateFileMapping(
-            file_handle_,
+            file_handles_[0],
             nullptr,
             PAGE_READWRITE,
             0,
@@ -501,7 +2225,7 @@ private:
             header_block_size,
             PROT_READ | PROT_WRITE,
             MAP_SHARED,
-            file_handle_,
+            file_handles_[0],
             0
         );
         if (data == MAP_FAILED) {
@@ -516,7 +2240,12 @@ private:
 #ifdef _WIN32
         UnmapViewOfFile(block.data);
 #else
-        munmap(block.data, block_size_);
+        if (reserved_base_ != nullptr) {
+            // 用不可访问的匿名映射替换，保持地址空间预留
+            mmap(block.data, block_size_, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+        } else {
+            munmap(block.data, block_size_);
+        }
 #endif
     }
 
@@ -524,15 +2253,54 @@ private:
         MapBlock(block_index);
     }
 
-    void FlushBlock(size_t block_index) {
+    // 确保 [offset, offset + length) 覆盖的所有块都已映射
+    void EnsureRangeMapped(uint64_t offset, size_t length) {
+        const size_t last = (offset + std::max<size_t>(length, 1) - 1) / block_size_;
+        for (size_t block_index = offset / block_size_; block_index <= last; ++block_index) {
+            MapBlock(block_index);
+        }
+    }
+
+    void FlushRange(uint64_t offset, size_t length) {
+        // 纯内存模式不刷盘
+        if (length == 0 || memory_only_) {
+            return;
+        }
+        const uint64_t end = offset + length;
+        while (offset < end) {
+            const size_t block_index = offset / block_size_;
+            const uint64_t block_end = std::min<uint64_t>((block_index + 1) * block_size_, end);
+            FlushBlock(block_index, offset % block_size_, block_end - offset);
+            offset = block_end;
+        }
+    }
+
+    // 只刷新块内实际写入的页，刷盘开销与块大小无关
+    void FlushBlock(size_t block_index, size_t block_offset, size_t length) {
         // 跳过头部块
         if (block_index == 0) return;
-        
+
+        const size_t start = block_offset - block_offset % PageSize();
+        std::byte* data = mapped_blocks_[block_index].data + start;
+        length += block_offset - start;
+#ifdef _WIN32
+        FlushViewOfFile(data, length);
+#else
+        msync(data, length, MS_SYNC);
+#endif
+    }
+
+    static size_t PageSize() {
 #ifdef _WIN32
-        FlushViewOfFile(mapped_blocks_[block_index].data, block_size_);
+        static const size_t page_size = [] {
+            SYSTEM_INFO info;
+            GetSystemInfo(&info);
+            return static_cast<size_t>(info.dwPageSize);
+        }();
 #else
-        msync(mapped_blocks_[block_index].data, block_size_, MS_SYNC);
+        static const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
 #endif
+        return page_size;
     }
 
     std::byte* GetBlockPtr(uint64_t offset) {
@@ -542,22 +2310,100 @@ private:
     }
 
     void FlushHeader() {
+        if (!memory_only_) {
 #ifdef _WIN32
-        FlushViewOfFile(header_, sizeof(QueueHeader));
+            FlushViewOfFile(header_, sizeof(QueueHeader));
+#else
+            msync(header_, sizeof(QueueHeader), MS_SYNC);
+#endif
+        }
+        activity_++;
+        PublishState();
+    }
+
+    // 头部变化后发出通知：唤醒等待通知序号的读取器，描述符只在状态切换时产生系统调用
+    void PublishState() {
+#ifdef __linux__
+        // 读取器先登记等待者再等待通知序号，这里先递增序号再检查等待者，两者至少有一方看到对方的修改
+        __atomic_add_fetch(&header_->notify_seq, 1, __ATOMIC_SEQ_CST);
+        if (notify_ != nullptr && __atomic_load_n(&notify_->waiters, __ATOMIC_SEQ_CST) > 0) {
+            FutexWake(&header_->notify_seq);
+        }
+
+        const bool has_data = header_->count > 0;
+        if (data_fd_ != -1 && has_data != data_signaled_) {
+            // 空变为非空时置位，非空变为空时清零，使描述符在有数据时保持可读
+            if (has_data) {
+                eventfd_write(data_fd_, 1);
+            } else {
+                eventfd_t value;
+                eventfd_read(data_fd_, &value);
+            }
+            data_signaled_ = has_data;
+        }
+        if (space_wanted_ && header_->size < full_size_) {
+            space_wanted_ = false;
+            if (space_fd_ != -1) {
+                eventfd_write(space_fd_, 1);
+            }
+        }
+#endif
+    }
+
+    // 打开通知文件并清零等待者计数（崩溃的读取器可能残留计数，正在等待的读取器会按超时重新登记）
+    void OpenNotifyFile(const std::string& path) {
+#ifdef __linux__
+        const int fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd == -1) {
+            throw std::runtime_error("Failed to open notify file: " + path);
+        }
+        void* state = MAP_FAILED;
+        if (ftruncate(fd, sizeof(NotifyState)) == 0) {
+            state = mmap(nullptr, sizeof(NotifyState), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        close(fd);
+        if (state == MAP_FAILED) {
+            throw std::runtime_error("Failed to memory map notify file: " + path);
+        }
+        notify_ = static_cast<NotifyState*>(state);
+        __atomic_store_n(&notify_->waiters, 0, __ATOMIC_SEQ_CST);
 #else
-        msync(header_, sizeof(QueueHeader), MS_SYNC);
+        (void)path;
+#endif
+    }
+
+    // 入队因空间不足失败，空间释放后通过 space_fd_ 通知
+    void MarkFull() {
+        space_wanted_ = true;
+        full_size_ = header_->size;
+    }
+
+    // 创建非阻塞的 eventfd
+    static int CreateEventFd() {
+#ifdef __linux__
+        const int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (fd == -1) {
+            throw std::runtime_error("Failed to create eventfd");
+        }
+        return fd;
+#else
+        throw std::runtime_error("Notification handles are only supported on Linux");
 #endif
     }
 
     void MapBlock(size_t block_index) {
         if (mapped_blocks_.find(block_index) == mapped_blocks_.end()) {
+            // 块 i 位于条带 i % n 的第 i / n 个块
+            const size_t stripes = file_handles_.size();
+            FileHandle handle = file_handles_[block_index % stripes];
+            const uint64_t file_offset = static_cast<uint64_t>(block_index / stripes) * block_size_;
 #ifdef _WIN32
             HANDLE mapping = CreateFileMapping(
-                file_handle_,
+                handle,
                 nullptr,
                 PAGE_READWRITE,
                 0,
-                block_size_,
+                0,
                 nullptr
             );
             if (mapping == nullptr) {
@@ -567,8 +2413,8 @@ private:
             void* data = MapViewOfFile(
                 mapping,
                 FILE_MAP_ALL_ACCESS,
-                0,
-                block_index * block_size_,
+                static_cast<DWORD>(file_offset >> 32),
+                static_cast<DWORD>(file_offset & 0xFFFFFFFF),
                 block_size_
             );
             CloseHandle(mapping);
@@ -576,13 +2422,25 @@ private:
                 throw std::runtime_error("Failed to map view of file");
             }
 #else
+            void* address = nullptr;
+            int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+            if (lazy_open_) {
+                // 首次访问时一次性预读整个块，避免后续逐页缺页
+                flags |= MAP_POPULATE;
+            }
+#endif
+            if (reserved_base_ != nullptr && (block_index + 1) * block_size_ <= reserved_size_) {
+                address = reserved_base_ + block_index * block_size_;
+                flags |= MAP_FIXED;
+            }
             void* data = mmap(
-                nullptr,
+                address,
                 block_size_,
                 PROT_READ | PROT_WRITE,
-                MAP_SHARED,
-                file_handle_,
-                block_index * block_size_
+                flags,
+                handle,
+                file_offset
             );
             if (data == MAP_FAILED) {
                 throw std::runtime_error("Failed to memory map block");
@@ -595,31 +2453,176 @@ private:
     }
 
     std::string file_path_;
+    std::string quarantine_path_;
+    fs::path delay_dir_;
     size_t block_size_;
-    FileHandle file_handle_;
+    CorruptionPolicy corruption_policy_;
+    CorruptionStats corruption_stats_;
+    std::vector<std::string> file_paths_;    // 各条带文件路径，下标 0 为主文件
+    std::vector<FileHandle> file_handles_;   // 各条带文件句柄
+    std::byte* reserved_base_ = nullptr;     // 预留地址空间的起始地址
+    size_t reserved_size_ = 0;               // 预留地址空间的大小
     QueueHeader* header_;
     std::map<size_t, MappedBlock> mapped_blocks_;
     mutable std::mutex mutex_;
     std::shared_ptr<spdlog::logger> logger_;
+
+    // 优先级通道
+    size_t lane_count_;                // 通道数
+    size_t starvation_limit_;          // 低优先级通道被连续跳过的次数上限，0 表示严格按优先级
+    size_t bypassed_ = 0;              // 低优先级通道已被连续跳过的次数
+    std::vector<LaneRuntime> lanes_;   // 各通道的进程内状态
+
+    // 延迟打开：只校验头部，新文件按需扩展，数据块首次访问时映射并预读
+    bool lazy_open_;
+
+    // 纯内存模式：条带文件是匿名内存文件，刷盘为空操作
+    bool memory_only_;
+
+    // 记录格式：新文件使用 format_version_（0 表示默认版本）和 record_alignment_，已有文件使用头部中的设置
+    uint64_t format_version_;
+    size_t record_alignment_;
+    RecordFormat format_{};
+
+    // 直接 I/O 写入器，为空时通过映射写入数据区
+    std::unique_ptr<DirectWriter> direct_;
+
+    // 磁盘空间回收（受 mutex_ 保护）
+    bool punch_consumed_blocks_;                   // 是否在已消费的块上打洞
+    std::chrono::milliseconds shrink_idle_time_;   // 收缩文件前要求的空闲时间
+    bool adaptive_block_size_;                     // 空闲的空队列是否按记录大小分布调整块大小
+    uint64_t activity_ = 0;                        // 头部刷新次数，用于判断队列是否空闲
+    uint64_t observed_activity_ = 0;               // 上次 Compact 观察到的 activity_
+    std::chrono::steady_clock::time_point idle_since_ = std::chrono::steady_clock::now();
+
+    // 租约模式状态
+    std::chrono::milliseconds visibility_timeout_;
+    std::deque<LeaseDeadline> lease_deadlines_;  // 未确认租约的超时队列
+    size_t leased_count_ = 0;                    // 已投递但尚未确认的记录数
+
+    // 可轮询的通知描述符（受 mutex_ 保护）
+    int data_fd_ = -1;               // 队列非空时可读
+    int space_fd_ = -1;              // 入队因空间不足失败后，空间释放时可读
+    NotifyState* notify_ = nullptr;  // 通知文件的映射，纯内存队列中为空
+    bool data_signaled_ = false;     // data_fd_ 当前是否处于可读状态
+    bool space_wanted_ = false;      // 是否有入队因空间不足失败
+    uint64_t full_size_ = 0;         // 入队失败时的队列字节数
+
+    // 新记录提交通知
+    std::recursive_mutex callback_mutex_;  // 回调中恢复的协程可能再次入队
+    std::function<void()> data_available_;
+
+    // 延迟记录存储（受 mutex_ 保护）
+    std::unique_ptr<DelayedRecordStore> delayed_;
+
+    // 投递定时线程
+    std::thread delivery_;
+    std::mutex delivery_mutex_;
+    std::condition_variable delivery_cv_;
+    bool delivery_stop_ = false;
+    bool delivery_wakeup_ = false;  // 新增了延迟记录，需要重新计算等待时间
+
+    // 后台巡检状态（scrub_epoch_ 和 scrubber_running_ 受 mutex_ 保护）
+    uint64_t scrub_epoch_ = 0;       // 读取位置跳变时递增
+    bool scrubber_running_ = false;  // 巡检线程是否在运行，运行期间不收缩文件
+    std::thread scrubber_;
+    std::mutex scrub_mutex_;
+    std::condition_variable scrub_cv_;
+    bool scrub_stop_ = false;
 };
 
+// 将位置参数转换为队列配置
+static QueueOptions MakeOptions(std::string_view storage_dir, size_t block_size, std::string_view log_dir) {
+    QueueOptions options;
+    options.storage_dir = storage_dir;
+    options.block_size = block_size;
+    options.log_dir = log_dir;
+    return options;
+}
+
 // PersistentQueue 实现
 PersistentQueue::PersistentQueue(std::string_view queue_name, 
                                std::string_view storage_dir,
                                size_t block_size,
                                std::string_view log_dir)
-    : pimpl_(std::make_unique<Impl>(queue_name, storage_dir, block_size, log_dir)) {}
+    : PersistentQueue(queue_name, MakeOptions(storage_dir, block_size, log_dir)) {}
+
+PersistentQueue::PersistentQueue(std::string_view queue_name, const QueueOptions& options)
+    : pimpl_(std::make_unique<Impl>(queue_name, options)) {}
 
 PersistentQueue::~PersistentQueue() = default;
 
 bool PersistentQueue::Enqueue(const std::vector<std::byte>& data) {
-    return pimpl_->Enqueue(data);
+    return Enqueue(data, 0);
+}
+
+bool PersistentQueue::Enqueue(const std::vector<std::byte>& data, size_t priority) {
+    if (!pimpl_->Enqueue(data, priority)) {
+        return false;
+    }
+    pimpl_->NotifyDataAvailable();
+    return true;
+}
+
+EnqueueStatus PersistentQueue::EnqueueIdempotent(uint64_t producer_id, uint64_t sequence,
+                                                 const std::vector<std::byte>& data, size_t priority) {
+    const EnqueueStatus status = pimpl_->EnqueueIdempotent(producer_id, sequence, data, priority);
+    if (status == EnqueueStatus::kEnqueued) {
+        pimpl_->NotifyDataAvailable();
+    }
+    return status;
+}
+
+std::optional<uint64_t> PersistentQueue::LastSequence(uint64_t producer_id) const {
+    return pimpl_->LastSequence(producer_id);
+}
+
+bool PersistentQueue::RemoveProducer(uint64_t producer_id) {
+    return pimpl_->RemoveProducer(producer_id);
+}
+
+PersistentQueue::Transaction PersistentQueue::BeginTxn(size_t priority) const {
+    return Transaction(priority);
+}
+
+bool PersistentQueue::CommitTxn(Transaction& txn) {
+    if (!pimpl_->CommitTxn(txn.records_, txn.priority_)) {
+        return false;
+    }
+    txn.records_.clear();
+    pimpl_->NotifyDataAvailable();
+    return true;
+}
+
+void PersistentQueue::Transaction::Append(const std::vector<std::byte>& data) {
+    records_.push_back(data);
+}
+
+size_t PersistentQueue::Transaction::Size() const {
+    return records_.size();
+}
+
+bool PersistentQueue::EnqueueAt(const std::vector<std::byte>& data,
+                                std::chrono::system_clock::time_point deliver_after) {
+    // 写入延迟存储的记录尚不可见，不通知等待者；到期后由投递线程通知
+    if (pimpl_->EnqueueDelayed(data, deliver_after)) {
+        return true;
+    }
+    return Enqueue(data, 0);
 }
 
 std::optional<std::vector<std::byte>> PersistentQueue::Dequeue() {
     return pimpl_->Dequeue();
 }
 
+size_t PersistentQueue::ForEach(size_t max_items, const RecordVisitor& visitor, size_t checkpoint_interval) {
+    return pimpl_->ForEach(max_items, visitor, checkpoint_interval);
+}
+
+std::optional<std::vector<std::byte>> PersistentQueue::Peek() {
+    return pimpl_->Peek();
+}
+
 size_t PersistentQueue::Size() const {
     return pimpl_->Size();
 }
@@ -632,4 +2635,100 @@ bool PersistentQueue::Empty() const {
     return pimpl_->Empty();
 }
 
+size_t PersistentQueue::LaneSize(size_t priority) const {
+    return pimpl_->LaneSize(priority);
+}
+
+size_t PersistentQueue::DelayedSize() const {
+    return pimpl_->DelayedSize();
+}
+
+std::optional<LeasedRecord> PersistentQueue::Receive() {
+    return pimpl_->Receive();
+}
+
+bool PersistentQueue::Ack(uint64_t lease_id) {
+    return pimpl_->Ack(lease_id);
+}
+
+size_t PersistentQueue::LeasedCount() const {
+    return pimpl_->LeasedCount();
+}
+
+void PersistentQueue::StartScrubber(ScrubberOptions options) {
+    pimpl_->StartScrubber(std::move(options));
+}
+
+void PersistentQueue::StopScrubber() {
+    pimpl_->StopScrubber();
+}
+
+size_t PersistentQueue::ScrubbedBytes() const {
+    return pimpl_->ScrubbedBytes();
+}
+
+CorruptionStats PersistentQueue::GetCorruptionStats() const {
+    return pimpl_->GetCorruptionStats();
+}
+
+int PersistentQueue::DataAvailableFd() {
+    return pimpl_->DataAvailableFd();
+}
+
+int PersistentQueue::SpaceAvailableFd() {
+    return pimpl_->SpaceAvailableFd();
+}
+
+RecordSizeStats PersistentQueue::GetRecordSizeStats() const {
+    return pimpl_->GetRecordSizeStats();
+}
+
+size_t PersistentQueue::RecommendBlockSize(const RecordSizeStats& stats) {
+    constexpr size_t MIN_BLOCK_SIZE = 64 * 1024;
+    constexpr uint64_t RECORDS_PER_BLOCK = 256;
+    uint64_t total = 0;
+    for (uint64_t count : stats.buckets) {
+        total += count;
+    }
+    if (total == 0) {
+        return DEFAULT_BLOCK_SIZE;
+    }
+    // 第 99 百分位所在的桶，按桶上界估算记录大小
+    const uint64_t target = total - total / 100;
+    uint64_t seen = 0;
+    size_t bucket = 0;
+    for (; bucket + 1 < RecordSizeStats::BUCKETS; ++bucket) {
+        seen += stats.buckets[bucket];
+        if (seen >= target) {
+            break;
+        }
+    }
+    const uint64_t wanted = (2ULL << bucket) * RECORDS_PER_BLOCK;
+    size_t block_size = MIN_BLOCK_SIZE;
+    while (block_size < wanted && block_size < DEFAULT_BLOCK_SIZE) {
+        block_size *= 2;
+    }
+    return block_size;
+}
+
+size_t PersistentQueue::MappedBytes() const {
+    return pimpl_->MappedBytes();
+}
+
+bool PersistentQueue::Preallocate() {
+    return pimpl_->Preallocate();
+}
+
+size_t PersistentQueue::Compact() {
+    return pimpl_->Compact();
+}
+
+size_t PersistentQueue::Snapshot(const std::string& path) {
+    return pimpl_->Snapshot(path);
+}
+
+void PersistentQueue::SetDataAvailableCallback(std::function<void()> callback) {
+    pimpl_->SetDataAvailableCallback(std::move(callback));
+}
+
 } // namespace persistent_file_queue 
\ No newline at end of file
@@ -0,0 +1,77 @@
+#include "queue_format.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace persistent_file_queue {
+
+namespace {
+
+// v2 校验和：按 8 字节字做 Fletcher 式累加，末尾不足 8 字节的部分补零，长度参与计算
+uint32_t CalculateChecksum32(const std::byte* data, size_t length) {
+    uint64_t sum = length;
+    uint64_t sum_of_sums = 0;
+    size_t offset = 0;
+    for (; offset + sizeof(uint64_t) <= length; offset += sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, data + offset, sizeof(word));
+        sum += word;
+        sum_of_sums += sum;
+    }
+    uint64_t tail = 0;
+    std::memcpy(&tail, data + offset, length - offset);
+    sum += tail;
+    sum_of_sums += sum;
+    const uint64_t mixed = sum ^ (sum_of_sums * 0x9E3779B97F4A7C15ULL);
+    return static_cast<uint32_t>(mixed ^ (mixed >> 32));
+}
+
+constexpr RecordFormat FORMATS[] = {
+    {FORMAT_V1, sizeof(std::byte), 1},
+    {FORMAT_V2, sizeof(uint32_t), 8},
+};
+
+} // namespace
+
+void RecordFormat::WriteChecksum(const std::byte* data, size_t length, std::byte* out) const {
+    if (version == FORMAT_V1) {
+        *out = CalculateChecksum(data, length);
+    } else {
+        const uint32_t checksum = CalculateChecksum32(data, length);
+        std::memcpy(out, &checksum, sizeof(checksum));
+    }
+}
+
+bool RecordFormat::VerifyChecksum(const std::byte* data, size_t length) const {
+    if (version == FORMAT_V1) {
+        return CalculateChecksum(data, length) == data[length];
+    }
+    uint32_t stored;
+    std::memcpy(&stored, data + length, sizeof(stored));
+    return CalculateChecksum32(data, length) == stored;
+}
+
+const RecordFormat* FindRecordFormat(uint64_t version) {
+    for (const RecordFormat& format : FORMATS) {
+        if (format.version == version) {
+            return &format;
+        }
+    }
+    return nullptr;
+}
+
+RecordFormat ResolveRecordFormat(uint64_t version, uint64_t record_alignment) {
+    const RecordFormat* format = FindRecordFormat(version);
+    if (format == nullptr) {
+        throw std::runtime_error("Unsupported file version");
+    }
+    if (!IsValidRecordAlignment(record_alignment)) {
+        throw std::runtime_error("Unsupported record alignment");
+    }
+    RecordFormat resolved = *format;
+    resolved.alignment = std::max<size_t>(resolved.alignment, record_alignment);
+    return resolved;
+}
+
+} // namespace persistent_file_queue
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <chrono>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <ctime>
+#endif
+
+#include "persistent_file_queue/persistent_queue.h"
+
+// 简单的校验和计算：所有字节相加
+std::byte CalculateChecksum(const std::byte* data, size_t length);
+
+namespace persistent_file_queue {
+
+// 队列文件格式：第 0 个块为头部块，数据区从 block_size 开始；
+// 每条记录为 数据大小(uint32) + 数据 + 校验和，校验和的宽度和记录对齐方式由头部中的格式版本决定，
+// 头部中的 record_alignment 可以把对齐放大到缓存行
+
+inline constexpr uint64_t MAGIC_NUMBER = 0xDEADBEEFCAFEBABE;
+
+// 记录格式版本，头部布局在各版本间相同：
+//   v1：1 字节校验和（所有字节相加），记录紧密排列
+//   v2：4 字节校验和（按 8 字节字累加的 Fletcher 式校验和），记录按 8 字节对齐，对齐填充为零且不参与校验
+inline constexpr uint64_t FORMAT_V1 = 1;
+inline constexpr uint64_t FORMAT_V2 = 2;
+static_assert(PersistentQueue::DEFAULT_FORMAT_VERSION == FORMAT_V1);
+static_assert(PersistentQueue::LATEST_FORMAT_VERSION == FORMAT_V2);
+
+// 记录对齐的上限（QueueOptions::record_alignment 最大为两个缓存行）
+inline constexpr size_t MAX_RECORD_ALIGNMENT = 128;
+
+// 记录对齐：0 表示使用格式版本自身的对齐，否则为不超过 MAX_RECORD_ALIGNMENT 的 2 的幂
+inline bool IsValidRecordAlignment(uint64_t alignment) {
+    return alignment <= MAX_RECORD_ALIGNMENT && (alignment & (alignment - 1)) == 0;
+}
+
+// 记录格式
+struct RecordFormat {
+    uint64_t version;
+    size_t checksum_size;  // 校验和字节数
+    size_t alignment;      // 记录占用的字节数向上对齐到的粒度
+
+    // 数据大小为 data_size 的记录占用的字节数（大小字段 + 数据 + 校验和 + 对齐填充）
+    size_t RecordSize(size_t data_size) const {
+        const size_t size = sizeof(uint32_t) + data_size + checksum_size;
+        return (size + alignment - 1) / alignment * alignment;
+    }
+
+    // 计算数据的校验和，写入 out 起的 checksum_size 个字节
+    void WriteChecksum(const std::byte* data, size_t length, std::byte* out) const;
+
+    // 校验紧跟在数据之后的校验和
+    bool VerifyChecksum(const std::byte* data, size_t length) const;
+};
+
+// 查找已注册的记录格式，不支持的版本返回 nullptr
+const RecordFormat* FindRecordFormat(uint64_t version);
+
+// 头部中的格式版本和记录对齐对应的记录格式：record_alignment 大于版本自身的对齐时按它对齐，
+// 对齐填充同样为零且不参与校验。版本或对齐不受支持时抛出 std::runtime_error
+RecordFormat ResolveRecordFormat(uint64_t version, uint64_t record_alignment);
+
+// 头部块固定为4KB
+inline constexpr size_t HEADER_BLOCK_SIZE = 4096;
+
+// 数据块大小必须是头部块大小的整数倍，这样块边界与页对齐
+inline bool IsValidBlockSize(uint64_t block_size) {
+    return block_size >= HEADER_BLOCK_SIZE && block_size % HEADER_BLOCK_SIZE == 0;
+}
+
+// 回绕标记：区域末尾剩余空间放不下下一条记录时写在长度字段位置
+inline constexpr uint32_t WRAP_MARKER = 0xFFFFFFFF;
+
+// 优先级通道状态
+struct LaneHeader {
+    uint64_t begin;      // 通道区域起始位置
+    uint64_t end;        // 通道区域结束位置
+    uint64_t write_pos;  // 通道写入位置
+    uint64_t read_pos;   // 通道读取位置
+    uint64_t size;       // 通道占用的字节数
+    uint64_t count;      // 通道中数据项的数量
+};
+
+// 幂等生产者状态
+struct ProducerEntry {
+    uint64_t producer_id;    // 生产者标识，0 表示空槽
+    uint64_t next_sequence;  // 下一个可接受的最小序列号
+};
+
+// 独占缓存行的游标：生产者和消费者各自更新自己的游标时不会互相使对方的缓存行失效
+struct alignas(MAX_RECORD_ALIGNMENT) PaddedCursor {
+    uint64_t value;
+};
+
+// 文件头部结构
+struct QueueHeader {
+    uint64_t head;       // 队列头位置
+    uint64_t tail;       // 队列尾位置
+    uint64_t capacity;   // 队列容量
+    uint64_t size;       // 当前队列大小（字节数）
+    uint64_t count;      // 当前队列中数据项的数量
+    uint64_t block_size; // 块大小
+    uint64_t max_size;   // 最大文件大小
+    uint64_t write_pos;  // 当前写入位置
+    uint64_t read_pos;   // 当前读取位置
+    uint64_t magic;      // 魔数，用于验证文件格式
+    uint64_t version;    // 版本号
+    std::byte checksum;  // 头部校验和
+    // 以下为扩展字段，旧版本文件中为 0
+    uint64_t stripe_count;  // 条带数（0 等同于 1）
+    uint64_t lane_count;    // 优先级通道数（0 等同于 1，此时使用上面的读写位置）
+    LaneHeader lanes[PersistentQueue::MAX_PRIORITY_LANES];  // 多通道时各通道的状态，size/count 汇总到上面的字段
+    ProducerEntry producers[PersistentQueue::MAX_PRODUCERS];  // 幂等生产者表，按生产者标识开放寻址
+    // 跨进程通知：每次刷新头部后递增 notify_seq，通知文件中有等待者时唤醒（futex）
+    uint32_t notify_seq;  // 通知序号
+    uint64_t record_sizes[RecordSizeStats::BUCKETS];  // 写入记录的大小分布，用于自适应块大小
+    uint64_t record_alignment;  // 记录对齐（0 表示使用格式版本自身的对齐）
+    // 设置了记录对齐的文件中，单通道读写位置改用以下独占缓存行的游标，上面的 write_pos/read_pos 不再使用
+    PaddedCursor write_cursor;
+    PaddedCursor read_cursor;
+};
+
+static_assert(sizeof(QueueHeader) <= HEADER_BLOCK_SIZE, "QueueHeader must fit in the header block");
+
+// 单通道读取位置
+template <typename Header>
+auto& HeaderReadPos(Header& header) {
+    return header.record_alignment != 0 ? header.read_cursor.value : header.read_pos;
+}
+
+// 单通道写入位置
+template <typename Header>
+auto& HeaderWritePos(Header& header) {
+    return header.record_alignment != 0 ? header.write_cursor.value : header.write_pos;
+}
+
+// 条带文件路径：第 0 个条带为主文件（包含头部块），其余条带依次位于 stripe_dirs 中
+inline std::string StripeFilePath(const QueueOptions& options, std::string_view queue_name, size_t stripe) {
+    if (stripe == 0) {
+        return (std::filesystem::path(options.storage_dir) / (std::string(queue_name) + ".dat")).string();
+    }
+    return (std::filesystem::path(options.stripe_dirs[stripe - 1]) /
+            (std::string(queue_name) + ".stripe" + std::to_string(stripe) + ".dat"))
+        .string();
+}
+
+// 通知文件：头部对读取器只读，读取器在与队列文件并列的通知文件中登记等待者，
+// 写入方只在有等待者时发出 futex 唤醒
+struct NotifyState {
+    uint32_t waiters;  // 正在等待通知序号变化的读取器线程数
+};
+
+inline std::string NotifyFilePath(const QueueOptions& options, std::string_view queue_name) {
+    return (std::filesystem::path(options.storage_dir) / (std::string(queue_name) + ".notify")).string();
+}
+
+#ifdef __linux__
+// 等待通知序号离开 expected 或超时；队列文件的共享映射使 futex 可以跨进程使用
+inline void FutexWait(const uint32_t* word, uint32_t expected, std::chrono::nanoseconds timeout) {
+    const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(timeout);
+    timespec ts{};
+    ts.tv_sec = static_cast<time_t>(seconds.count());
+    ts.tv_nsec = static_cast<long>((timeout - seconds).count());
+    syscall(SYS_futex, word, FUTEX_WAIT, expected, &ts, nullptr, 0);
+}
+
+// 唤醒所有等待通知序号变化的线程
+inline void FutexWake(uint32_t* word) {
+    syscall(SYS_futex, word, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+#endif
+
+} // namespace persistent_file_queue
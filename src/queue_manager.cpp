@@ -0,0 +1,194 @@
+#include "persistent_file_queue/queue_manager.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <spdlog/spdlog.h>
+
+namespace persistent_file_queue {
+
+class QueueManager::Impl {
+public:
+    explicit Impl(QueueManagerOptions options) : options_(std::move(options)) {
+        if (options_.maintenance_interval.count() <= 0) {
+            throw std::invalid_argument("Invalid maintenance interval");
+        }
+        maintainer_ = std::thread([this] { MaintenanceLoop(); });
+    }
+
+    ~Impl() {
+        {
+            std::scoped_lock lock(stop_mutex_);
+            stop_ = true;
+        }
+        stop_cv_.notify_all();
+        maintainer_.join();
+
+        std::scoped_lock lock(mutex_);
+        for (const auto& [name, entry] : queues_) {
+            if (entry.queue.use_count() > 1) {
+                spdlog::warn("Queue {} is still in use when the manager is destroyed", name);
+            }
+        }
+        queues_.clear();
+    }
+
+    std::shared_ptr<PersistentQueue> Get(std::string_view queue_name) {
+        std::scoped_lock lock(mutex_);
+        auto [it, inserted] = queues_.try_emplace(std::string(queue_name));
+        if (inserted) {
+            try {
+                it->second.queue = std::make_shared<PersistentQueue>(queue_name, options_.queue_options);
+            } catch (...) {
+                queues_.erase(it);
+                throw;
+            }
+        }
+        it->second.last_used = Clock::now();
+        return it->second.queue;
+    }
+
+    void RunMaintenance() {
+        // 预分配和压缩在管理器锁之外进行，文件操作不阻塞其他队列的打开
+        if (options_.preallocate || options_.compact) {
+            std::vector<std::shared_ptr<PersistentQueue>> queues;
+            {
+                std::scoped_lock lock(mutex_);
+                queues.reserve(queues_.size());
+                for (const auto& [_, entry] : queues_) {
+                    queues.push_back(entry.queue);
+                }
+            }
+            for (const auto& queue : queues) {
+                try {
+                    if (options_.compact) {
+                        queue->Compact();
+                    }
+                    if (options_.preallocate) {
+                        queue->Preallocate();
+                    }
+                } catch (const std::exception& e) {
+                    spdlog::error("Failed to maintain queue file: {}", e.what());
+                }
+            }
+        }
+
+        std::scoped_lock lock(mutex_);
+        const auto now = Clock::now();
+        if (options_.idle_timeout.count() > 0) {
+            for (auto it = queues_.begin(); it != queues_.end();) {
+                if (IsIdle(it->second) && now - it->second.last_used >= options_.idle_timeout) {
+                    spdlog::debug("Closing idle queue: {}", it->first);
+                    it = queues_.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+        if (options_.mapped_bytes_budget > 0) {
+            EnforceBudget();
+        }
+    }
+
+    size_t OpenCount() const {
+        std::scoped_lock lock(mutex_);
+        return queues_.size();
+    }
+
+    size_t MappedBytes() const {
+        std::scoped_lock lock(mutex_);
+        return TotalMappedBytes();
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        std::shared_ptr<PersistentQueue> queue;
+        Clock::time_point last_used;
+    };
+
+    // 只有管理器持有的队列才能关闭；新句柄只能在锁内通过 Get 产生，因此判断结果在锁内有效
+    static bool IsIdle(const Entry& entry) {
+        return entry.queue.use_count() == 1;
+    }
+
+    size_t TotalMappedBytes() const {
+        size_t total = 0;
+        for (const auto& [_, entry] : queues_) {
+            total += entry.queue->MappedBytes();
+        }
+        return total;
+    }
+
+    // 超出映射预算时按最久未访问的顺序关闭空闲队列
+    void EnforceBudget() {
+        size_t total = TotalMappedBytes();
+        while (total > options_.mapped_bytes_budget) {
+            auto victim = queues_.end();
+            for (auto it = queues_.begin(); it != queues_.end(); ++it) {
+                if (IsIdle(it->second) && (victim == queues_.end() || it->second.last_used < victim->second.last_used)) {
+                    victim = it;
+                }
+            }
+            if (victim == queues_.end()) {
+                spdlog::warn("Mapped bytes {} exceed budget {}, no idle queue to close", total,
+                             options_.mapped_bytes_budget);
+                return;
+            }
+            spdlog::debug("Closing queue {} to stay within mapped bytes budget", victim->first);
+            total -= victim->second.queue->MappedBytes();
+            queues_.erase(victim);
+        }
+    }
+
+    void MaintenanceLoop() {
+        std::unique_lock lock(stop_mutex_);
+        while (!stop_cv_.wait_for(lock, options_.maintenance_interval, [this] { return stop_; })) {
+            lock.unlock();
+            try {
+                RunMaintenance();
+            } catch (const std::exception& e) {
+                spdlog::error("Queue maintenance failed: {}", e.what());
+            }
+            lock.lock();
+        }
+    }
+
+    QueueManagerOptions options_;
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, Entry> queues_;  // 队列名称 -> 打开的队列（受 mutex_ 保护）
+
+    // 后台维护线程
+    std::thread maintainer_;
+    std::mutex stop_mutex_;
+    std::condition_variable stop_cv_;
+    bool stop_ = false;
+};
+
+QueueManager::QueueManager(QueueManagerOptions options) : pimpl_(std::make_unique<Impl>(std::move(options))) {}
+
+QueueManager::~QueueManager() = default;
+
+std::shared_ptr<PersistentQueue> QueueManager::Get(std::string_view queue_name) {
+    return pimpl_->Get(queue_name);
+}
+
+void QueueManager::RunMaintenance() {
+    pimpl_->RunMaintenance();
+}
+
+size_t QueueManager::OpenCount() const {
+    return pimpl_->OpenCount();
+}
+
+size_t QueueManager::MappedBytes() const {
+    return pimpl_->MappedBytes();
+}
+
+} // namespace persistent_file_queue
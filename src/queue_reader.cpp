@@ -0,0 +1,357 @@
+#include "persistent_file_queue/queue_reader.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "queue_format.h"
+
+namespace persistent_file_queue {
+
+class QueueReader::Impl {
+public:
+    Impl(std::string_view queue_name, const QueueOptions& options, size_t lane)
+        : block_size_(options.block_size), lane_(lane) {
+#ifdef _WIN32
+        (void)queue_name;
+        throw std::runtime_error("QueueReader is not supported on Windows");
+#else
+        try {
+            // 以只读方式打开所有条带文件
+            for (size_t stripe = 0; stripe <= options.stripe_dirs.size(); ++stripe) {
+                const std::string path = StripeFilePath(options, queue_name, stripe);
+                if (stripe == 0) {
+                    path_ = path;
+                }
+                const int fd = open(path.c_str(), O_RDONLY);
+                if (fd == -1) {
+                    throw std::runtime_error("Failed to open queue file: " + path);
+                }
+                fds_.push_back(fd);
+            }
+            // 持有主文件的共享锁直到关闭，写入方不会在此期间截断或重建文件（见 PersistentQueue::Compact）
+            if (flock(fds_[0], LOCK_SH) == -1) {
+                throw std::runtime_error("Failed to lock queue file: " + path_);
+            }
+
+            void* header = mmap(nullptr, HEADER_BLOCK_SIZE, PROT_READ, MAP_SHARED, fds_[0], 0);
+            if (header == MAP_FAILED) {
+                throw std::runtime_error("Failed to memory map header");
+            }
+            header_ = static_cast<const QueueHeader*>(header);
+
+            // 验证文件头部
+            if (header_->magic != MAGIC_NUMBER) {
+                throw std::runtime_error("Invalid file format: magic number mismatch");
+            }
+            format_ = ResolveRecordFormat(header_->version, header_->record_alignment);
+            // 以头部记录的块大小为准
+            if (!IsValidBlockSize(header_->block_size)) {
+                throw std::runtime_error("Invalid block size");
+            }
+            block_size_ = header_->block_size;
+            if (std::max<uint64_t>(header_->stripe_count, 1) != fds_.size()) {
+                throw std::runtime_error("Stripe count mismatch");
+            }
+            lane_count_ = std::max<uint64_t>(header_->lane_count, 1);
+            if (lane_ >= lane_count_) {
+                throw std::out_of_range("Invalid priority");
+            }
+
+            // 为数据块预留连续的地址空间，数据块按需以只读方式映射
+            reserved_size_ = header_->max_size;
+            void* base = mmap(nullptr, reserved_size_, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+            if (base == MAP_FAILED) {
+                throw std::runtime_error("Failed to reserve address space");
+            }
+            base_ = static_cast<std::byte*>(base);
+            mapped_.resize(reserved_size_ / block_size_, false);
+
+            OpenNotifyFile(NotifyFilePath(options, queue_name));
+            cursor_ = Snapshot().read_pos;
+        } catch (...) {
+            Release();
+            throw;
+        }
+#endif
+    }
+
+    ~Impl() {
+        Release();
+    }
+
+    std::optional<RecordView> Next() {
+        // 写入方和消费者可能同时修改头部，读到不一致的状态时重新读取
+        for (int attempt = 0; attempt < MAX_ATTEMPTS; ++attempt) {
+            const RingState ring = Snapshot();
+            uint64_t offset = Distance(ring, ring.read_pos, cursor_);
+            if (cursor_ < ring.begin || cursor_ >= ring.end || offset > ring.size) {
+                // 游标所在的记录已被消费，跳到当前读取位置
+                cursor_ = ring.read_pos;
+                offset = 0;
+            }
+            if (offset >= ring.size) {
+                return std::nullopt;  // 已读到写入位置
+            }
+
+            // 跳过区域末尾的回绕填充
+            uint64_t start = cursor_;
+            if (start + sizeof(uint32_t) <= ring.end) {
+                EnsureRangeMapped(start, sizeof(uint32_t));
+                uint32_t marker;
+                std::memcpy(&marker, base_ + start, sizeof(uint32_t));
+                if (marker == WRAP_MARKER) {
+                    start = ring.begin;
+                }
+            } else {
+                start = ring.begin;
+            }
+            const uint64_t padding = start == cursor_ ? 0 : ring.end - cursor_;
+
+            EnsureRangeMapped(start, sizeof(uint32_t));
+            uint32_t data_size;
+            std::memcpy(&data_size, base_ + start, sizeof(uint32_t));
+            const size_t total_size = format_.RecordSize(data_size);
+            if (offset + padding + total_size > ring.size || start + total_size > ring.end) {
+                // 游标处的记录已提交，读取位置不变时记录不会被覆盖，长度越界只能是数据损坏
+                if (Snapshot().read_pos != ring.read_pos) {
+                    continue;
+                }
+                throw std::runtime_error("Data corruption detected: invalid data size");
+            }
+
+            EnsureRangeMapped(start, total_size);
+            const std::byte* data = base_ + start + sizeof(uint32_t);
+            if (!format_.VerifyChecksum(data, data_size)) {
+                // 读取期间记录被消费并覆盖时重新读取，否则视为数据损坏
+                if (Snapshot().read_pos != ring.read_pos) {
+                    continue;
+                }
+                throw std::runtime_error("Data corruption detected: checksum mismatch");
+            }
+
+            cursor_ = start + total_size >= ring.end ? ring.begin + (start + total_size - ring.end)
+                                                     : start + total_size;
+            return RecordView{data, data_size};
+        }
+        return std::nullopt;
+    }
+
+    std::optional<RecordView> WaitNext(std::chrono::milliseconds timeout) {
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (true) {
+            // 先读取通知序号再检查新记录，检查之后的提交会改变序号，等待会立即返回
+            const uint32_t seq = LoadNotifySeq();
+            if (auto record = Next()) {
+                return record;
+            }
+            const auto now = std::chrono::steady_clock::now();
+            if (now >= deadline) {
+                return std::nullopt;
+            }
+            WaitForCommit(seq, deadline - now);
+        }
+    }
+
+    void SeekToHead() {
+        cursor_ = Snapshot().read_pos;
+    }
+
+    size_t LaneCount() const {
+        return lane_count_;
+    }
+
+private:
+    static constexpr int MAX_ATTEMPTS = 3;
+    static constexpr std::chrono::milliseconds POLL_INTERVAL{1};
+    static constexpr std::chrono::milliseconds MAX_WAIT_SLICE{100};
+
+    // 环形区域状态快照
+    struct RingState {
+        uint64_t read_pos;
+        uint64_t write_pos;
+        uint64_t size;
+        uint64_t begin;
+        uint64_t end;
+
+        bool operator==(const RingState& other) const {
+            return read_pos == other.read_pos && write_pos == other.write_pos && size == other.size &&
+                   begin == other.begin && end == other.end;
+        }
+    };
+
+    RingState ReadRing() const {
+        const volatile QueueHeader* header = header_;
+        RingState state;
+        if (lane_count_ == 1) {
+            state = {HeaderReadPos(*header), HeaderWritePos(*header), header->size, block_size_, header->capacity};
+        } else {
+            const volatile LaneHeader& lane = header->lanes[lane_];
+            state = {lane.read_pos, lane.write_pos, lane.size, lane.begin, lane.end};
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return state;
+    }
+
+    // 头部字段没有原子更新，连续两次读到相同的状态才使用
+    RingState Snapshot() const {
+        RingState state = ReadRing();
+        while (true) {
+            const RingState again = ReadRing();
+            if (again == state) {
+                return state;
+            }
+            state = again;
+        }
+    }
+
+    // 区域内从 from 到 to 的字节数
+    static uint64_t Distance(const RingState& ring, uint64_t from, uint64_t to) {
+        return to >= from ? to - from : (ring.end - from) + (to - ring.begin);
+    }
+
+    void EnsureRangeMapped(uint64_t offset, size_t length) {
+#ifndef _WIN32
+        // 块 i 位于条带 i % n 的第 i / n 个块
+        for (size_t block_index = offset / block_size_; block_index <= (offset + length - 1) / block_size_;
+             ++block_index) {
+            if (block_index >= mapped_.size()) {
+                throw std::runtime_error("Record offset out of range");
+            }
+            if (mapped_[block_index]) {
+                continue;
+            }
+            const size_t stripes = fds_.size();
+            const uint64_t file_offset = static_cast<uint64_t>(block_index / stripes) * block_size_;
+            void* data = mmap(base_ + block_index * block_size_, block_size_, PROT_READ, MAP_SHARED | MAP_FIXED,
+                              fds_[block_index % stripes], static_cast<off_t>(file_offset));
+            if (data == MAP_FAILED) {
+                throw std::runtime_error("Failed to memory map block");
+            }
+            mapped_[block_index] = true;
+        }
+#else
+        (void)offset;
+        (void)length;
+#endif
+    }
+
+    uint32_t LoadNotifySeq() const {
+#ifdef __linux__
+        return __atomic_load_n(&header_->notify_seq, __ATOMIC_SEQ_CST);
+#else
+        return 0;
+#endif
+    }
+
+    // 等待写入方刷新头部：在通知文件中登记等待者后，在只读映射的通知序号上等待（futex 支持只读映射）。
+    // 没有通知文件（写入方尚未打开队列或没有写权限）时按 POLL_INTERVAL 轮询
+    void WaitForCommit(uint32_t seq, std::chrono::nanoseconds timeout) {
+#ifdef __linux__
+        if (notify_ == nullptr) {
+            std::this_thread::sleep_for(std::min<std::chrono::nanoseconds>(POLL_INTERVAL, timeout));
+            return;
+        }
+        __atomic_add_fetch(&notify_->waiters, 1, __ATOMIC_SEQ_CST);
+        // 写入方重新打开队列时会清零等待者计数，分段等待以便重新登记
+        FutexWait(&header_->notify_seq, seq, std::min<std::chrono::nanoseconds>(MAX_WAIT_SLICE, timeout));
+        uint32_t waiters = __atomic_load_n(&notify_->waiters, __ATOMIC_SEQ_CST);
+        while (waiters > 0 && !__atomic_compare_exchange_n(&notify_->waiters, &waiters, waiters - 1, false,
+                                                           __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+        }
+#else
+        (void)seq;
+        std::this_thread::sleep_for(std::min<std::chrono::nanoseconds>(POLL_INTERVAL, timeout));
+#endif
+    }
+
+    // 以读写方式映射通知文件，只用于登记等待者；打开失败时退回轮询
+    void OpenNotifyFile(const std::string& path) {
+#ifdef __linux__
+        const int fd = open(path.c_str(), O_RDWR | O_CLOEXEC);
+        if (fd == -1) {
+            return;
+        }
+        void* state = MAP_FAILED;
+        struct stat st {};
+        if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(NotifyState)) {
+            state = mmap(nullptr, sizeof(NotifyState), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        close(fd);
+        if (state != MAP_FAILED) {
+            notify_ = static_cast<NotifyState*>(state);
+        }
+#else
+        (void)path;
+#endif
+    }
+
+    void Release() {
+#ifndef _WIN32
+        if (notify_ != nullptr) {
+            munmap(notify_, sizeof(NotifyState));
+            notify_ = nullptr;
+        }
+        if (base_ != nullptr) {
+            munmap(base_, reserved_size_);
+            base_ = nullptr;
+        }
+        if (header_ != nullptr) {
+            munmap(const_cast<QueueHeader*>(header_), HEADER_BLOCK_SIZE);
+            header_ = nullptr;
+        }
+        for (int fd : fds_) {
+            close(fd);
+        }
+        fds_.clear();
+#endif
+    }
+
+    std::string path_;                      // 主文件路径
+    size_t block_size_;
+    size_t lane_;
+    size_t lane_count_ = 1;
+    RecordFormat format_{};  // 头部中版本和记录对齐对应的记录格式
+    std::vector<int> fds_;                  // 各条带文件的只读句柄
+    const QueueHeader* header_ = nullptr;
+    NotifyState* notify_ = nullptr;         // 通知文件的映射，不存在时为空
+    std::byte* base_ = nullptr;             // 预留地址空间的起始地址
+    size_t reserved_size_ = 0;
+    std::vector<bool> mapped_;              // 各块是否已映射
+    uint64_t cursor_ = 0;                   // 下一条待读取记录的位置
+};
+
+QueueReader::QueueReader(std::string_view queue_name, const QueueOptions& options, size_t lane)
+    : pimpl_(std::make_unique<Impl>(queue_name, options, lane)) {}
+
+QueueReader::~QueueReader() = default;
+
+std::optional<RecordView> QueueReader::Next() {
+    return pimpl_->Next();
+}
+
+std::optional<RecordView> QueueReader::WaitNext(std::chrono::milliseconds timeout) {
+    return pimpl_->WaitNext(timeout);
+}
+
+void QueueReader::SeekToHead() {
+    pimpl_->SeekToHead();
+}
+
+size_t QueueReader::LaneCount() const {
+    return pimpl_->LaneCount();
+}
+
+} // namespace persistent_file_queue
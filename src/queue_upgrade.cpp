@@ -0,0 +1,190 @@
+#include "persistent_file_queue/queue_upgrade.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <spdlog/spdlog.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "persistent_file_queue/queue_reader.h"
+#include "queue_format.h"
+
+namespace fs = std::filesystem;
+
+namespace persistent_file_queue {
+
+namespace {
+
+// 每个事务迁移的记录数，每次提交只刷新一次头部
+constexpr size_t UPGRADE_BATCH = 4096;
+
+QueueHeader ReadHeader(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    QueueHeader header{};
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+        throw std::runtime_error("Failed to read queue header: " + path);
+    }
+    if (header.magic != MAGIC_NUMBER) {
+        throw std::runtime_error("Invalid file format: magic number mismatch");
+    }
+    return header;
+}
+
+void WriteHeader(const std::string& path, const QueueHeader& header) {
+#ifdef _WIN32
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    const bool ok = file.write(reinterpret_cast<const char*>(&header), sizeof(header)) && file.flush();
+#else
+    const int fd = open(path.c_str(), O_WRONLY);
+    const bool ok = fd != -1 && pwrite(fd, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header)) &&
+                    fsync(fd) == 0;
+    if (fd != -1) {
+        close(fd);
+    }
+#endif
+    if (!ok) {
+        throw std::runtime_error("Failed to write queue header: " + path);
+    }
+}
+
+// 同步目录项，使重命名在崩溃后保持
+void SyncDirectory(const fs::path& dir) {
+#ifndef _WIN32
+    const int fd = open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY);
+    const bool ok = fd != -1 && fsync(fd) == 0;
+    if (fd != -1) {
+        close(fd);
+    }
+    if (!ok) {
+        throw std::runtime_error("Failed to sync directory: " + dir.string());
+    }
+#else
+    (void)dir;
+#endif
+}
+
+// 把队列中未消费的记录按通道迁移到格式版本为 version、块大小为 block_size 的临时队列，
+// 迁移幂等生产者表和记录大小分布后重命名替换原文件。返回迁移的记录数
+size_t RewriteQueue(std::string_view queue_name, const QueueOptions& options, const QueueHeader& source_header,
+                    uint64_t version, size_t block_size) {
+    const std::string temp_name = std::string(queue_name) + ".upgrade";
+    const size_t stripes = options.stripe_dirs.size() + 1;
+    for (size_t stripe = 0; stripe < stripes; ++stripe) {
+        fs::remove(StripeFilePath(options, temp_name, stripe));
+    }
+
+    QueueOptions target_options = options;
+    target_options.block_size = block_size;
+    target_options.priority_lanes = std::max<uint64_t>(source_header.lane_count, 1);
+    target_options.format_version = version;
+    target_options.record_alignment = source_header.record_alignment;
+    target_options.lazy_open = false;
+    target_options.direct_io = false;
+    target_options.memory_only = false;
+
+    size_t migrated = 0;
+    try {
+        PersistentQueue target(temp_name, target_options);
+        for (size_t lane = 0; lane < target_options.priority_lanes; ++lane) {
+            QueueReader reader(queue_name, options, lane);
+            auto txn = target.BeginTxn(lane);
+            auto commit = [&] {
+                const size_t pending = txn.Size();
+                if (pending > 0 && !target.CommitTxn(txn)) {
+                    throw std::runtime_error("Not enough space to upgrade queue");
+                }
+                migrated += pending;
+            };
+            while (auto record = reader.Next()) {
+                txn.Append(std::vector<std::byte>(record->data, record->data + record->size));
+                if (txn.Size() >= UPGRADE_BATCH) {
+                    commit();
+                }
+            }
+            commit();
+        }
+        // 迁移的记录数必须与原文件头部一致，否则替换原文件会永久丢失数据
+        if (migrated != source_header.count) {
+            throw std::runtime_error("Migrated " + std::to_string(migrated) + " of " +
+                                     std::to_string(source_header.count) + " records, queue left unchanged");
+        }
+    } catch (...) {
+        for (size_t stripe = 0; stripe < stripes; ++stripe) {
+            fs::remove(StripeFilePath(options, temp_name, stripe));
+        }
+        fs::remove(NotifyFilePath(options, temp_name));
+        throw;
+    }
+    fs::remove(NotifyFilePath(options, temp_name));
+
+    // 迁移幂等生产者表，重试的入队在升级后仍能去重；记录大小分布保留原文件的累计值
+    const std::string temp_path = StripeFilePath(options, temp_name, 0);
+    QueueHeader target_header = ReadHeader(temp_path);
+    std::memcpy(target_header.producers, source_header.producers, sizeof(target_header.producers));
+    std::memcpy(target_header.record_sizes, source_header.record_sizes, sizeof(target_header.record_sizes));
+    WriteHeader(temp_path, target_header);
+
+    // 主文件（条带 0）在所有条带文件就位后最后替换，替换后同步各目录使重命名持久化
+    std::vector<fs::path> dirs;
+    for (size_t stripe = stripes; stripe-- > 0;) {
+        const fs::path target = StripeFilePath(options, queue_name, stripe);
+        fs::rename(StripeFilePath(options, temp_name, stripe), target);
+        if (std::find(dirs.begin(), dirs.end(), target.parent_path()) == dirs.end()) {
+            dirs.push_back(target.parent_path());
+        }
+    }
+    for (const auto& dir : dirs) {
+        SyncDirectory(dir);
+    }
+    return migrated;
+}
+
+} // namespace
+
+uint64_t QueueFormatVersion(std::string_view queue_name, const QueueOptions& options) {
+    return ReadHeader(StripeFilePath(options, queue_name, 0)).version;
+}
+
+size_t QueueBlockSize(std::string_view queue_name, const QueueOptions& options) {
+    return ReadHeader(StripeFilePath(options, queue_name, 0)).block_size;
+}
+
+size_t UpgradeQueue(std::string_view queue_name, const QueueOptions& options, uint64_t target_version) {
+    if (FindRecordFormat(target_version) == nullptr) {
+        throw std::invalid_argument("Unsupported format version");
+    }
+    const QueueHeader source_header = ReadHeader(StripeFilePath(options, queue_name, 0));
+    if (source_header.version == target_version) {
+        return 0;
+    }
+
+    const size_t migrated = RewriteQueue(queue_name, options, source_header, target_version, source_header.block_size);
+    spdlog::info("Upgraded queue {} from format version {} to {}, {} records migrated", queue_name,
+                 source_header.version, target_version, migrated);
+    return migrated;
+}
+
+size_t ReblockQueue(std::string_view queue_name, const QueueOptions& options, size_t block_size) {
+    if (!IsValidBlockSize(block_size)) {
+        throw std::invalid_argument("Block size must be a positive multiple of 4096");
+    }
+    const QueueHeader source_header = ReadHeader(StripeFilePath(options, queue_name, 0));
+    if (source_header.block_size == block_size) {
+        return 0;
+    }
+
+    const size_t migrated = RewriteQueue(queue_name, options, source_header, source_header.version, block_size);
+    spdlog::info("Reblocked queue {} from block size {} to {}, {} records migrated", queue_name,
+                 source_header.block_size, block_size, migrated);
+    return migrated;
+}
+
+} // namespace persistent_file_queue
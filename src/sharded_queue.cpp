@@ -0,0 +1,176 @@
+#include "persistent_file_queue/sharded_queue.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace persistent_file_queue {
+
+namespace {
+
+std::string ShardName(std::string_view queue_name, size_t shard) {
+    return std::string(queue_name) + "_shard" + std::to_string(shard);
+}
+
+// 读取分片记录开头的全局序列号；记录短于序列号时说明分片中的数据已损坏
+uint64_t ReadSequence(const std::byte* data, size_t size) {
+    if (size < sizeof(uint64_t)) {
+        throw std::runtime_error("Data corruption detected: shard record shorter than sequence number");
+    }
+    uint64_t sequence;
+    std::memcpy(&sequence, data, sizeof(uint64_t));
+    return sequence;
+}
+
+} // namespace
+
+ShardedPersistentQueue::ShardedPersistentQueue(std::string_view queue_name, size_t shard_count,
+                                               const QueueOptions& options)
+    : shard_mutexes_(shard_count) {
+    if (shard_count == 0) {
+        throw std::invalid_argument("Shard count must be positive");
+    }
+
+    // 已存在的分片数与配置不一致时，按键哈希的分布会改变，拒绝打开
+    size_t existing = 0;
+    while (fs::exists(fs::path(options.storage_dir) / (ShardName(queue_name, existing) + ".dat"))) {
+        existing++;
+    }
+    if (existing != 0 && existing != shard_count) {
+        throw std::runtime_error("Shard count mismatch");
+    }
+
+    shards_.reserve(shard_count);
+    for (size_t i = 0; i < shard_count; ++i) {
+        shards_.push_back(std::make_unique<PersistentQueue>(ShardName(queue_name, i), options));
+    }
+    merge_heads_.resize(shard_count);
+}
+
+ShardedPersistentQueue::~ShardedPersistentQueue() = default;
+
+bool ShardedPersistentQueue::Enqueue(const std::vector<std::byte>& data) {
+    // 每个线程从不同的分片开始轮询，减少生产者之间的锁竞争
+    thread_local size_t cursor = std::hash<std::thread::id>{}(std::this_thread::get_id());
+    for (size_t attempt = 0; attempt < shards_.size(); ++attempt) {
+        if (EnqueueToShard(cursor++ % shards_.size(), data)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ShardedPersistentQueue::Enqueue(std::string_view key, const std::vector<std::byte>& data) {
+    return EnqueueToShard(std::hash<std::string_view>{}(key) % shards_.size(), data);
+}
+
+std::optional<std::vector<std::byte>> ShardedPersistentQueue::DequeueShard(size_t shard) {
+    auto record = shards_.at(shard)->Dequeue();
+    if (!record) {
+        return std::nullopt;
+    }
+    ReadSequence(record->data(), record->size());
+    record->erase(record->begin(), record->begin() + sizeof(uint64_t));
+    return record;
+}
+
+std::optional<std::vector<std::byte>> ShardedPersistentQueue::DequeueOrdered() {
+    std::scoped_lock lock(merge_mutex_);
+
+    // 补齐各分片队首的序列号（原地读取，不拷贝记录），选出序列号最小的分片
+    std::optional<size_t> selected;
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        if (!merge_heads_[i]) {
+            shards_[i]->ForEach(1, [&](const RecordView& record) {
+                merge_heads_[i] = ReadSequence(record.data, record.size);
+                return false;
+            });
+            if (!merge_heads_[i]) {
+                continue;
+            }
+        }
+        if (!selected || *merge_heads_[i] < *merge_heads_[*selected]) {
+            selected = i;
+        }
+    }
+    if (!selected) {
+        return std::nullopt;
+    }
+
+    // 真正出队，确认与缓存的队首是同一条记录，只拷贝一次用户数据
+    const uint64_t expected = *merge_heads_[*selected];
+    merge_heads_[*selected].reset();
+    std::optional<std::vector<std::byte>> data;
+    shards_[*selected]->ForEach(1, [&](const RecordView& record) {
+        if (ReadSequence(record.data, record.size) != expected) {
+            return false;
+        }
+        data.emplace(record.data + sizeof(uint64_t), record.data + record.size);
+        return true;
+    });
+    if (!data) {
+        throw std::logic_error("Shard was consumed outside of the ordered reader");
+    }
+    return data;
+}
+
+size_t ShardedPersistentQueue::ShardCount() const {
+    return shards_.size();
+}
+
+size_t ShardedPersistentQueue::Size() const {
+    size_t count = 0;
+    for (const auto& shard : shards_) {
+        count += shard->Size();
+    }
+    return count;
+}
+
+size_t ShardedPersistentQueue::TotalBytes() const {
+    size_t size = 0;
+    for (const auto& shard : shards_) {
+        size += shard->TotalBytes();
+    }
+    return size;
+}
+
+bool ShardedPersistentQueue::Empty() const {
+    for (const auto& shard : shards_) {
+        if (!shard->Empty()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint64_t ShardedPersistentQueue::NextSequence() {
+    // 混合时钟：取墙上时间（纳秒）与上一个序列号加一中的较大值，
+    // 重启后无需扫描分片即可保持单调递增
+    const uint64_t now = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch())
+            .count());
+    uint64_t last = last_sequence_.load(std::memory_order_relaxed);
+    uint64_t next;
+    do {
+        next = std::max(now, last + 1);
+    } while (!last_sequence_.compare_exchange_weak(last, next, std::memory_order_relaxed));
+    return next;
+}
+
+bool ShardedPersistentQueue::EnqueueToShard(size_t shard, const std::vector<std::byte>& data) {
+    std::vector<std::byte> record(sizeof(uint64_t) + data.size());
+    std::memcpy(record.data() + sizeof(uint64_t), data.data(), data.size());
+    // 在分片写入锁内分配序列号，否则两个生产者写同一分片时序列号较大的记录可能先写入，归并读取会乱序
+    std::scoped_lock lock(shard_mutexes_[shard]);
+    const uint64_t sequence = NextSequence();
+    std::memcpy(record.data(), &sequence, sizeof(uint64_t));
+    return shards_[shard]->Enqueue(record);
+}
+
+} // namespace persistent_file_queue
@@ -0,0 +1,155 @@
+#include "persistent_file_queue/async_queue.h"
+#include "test_fixture.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+using namespace persistent_file_queue;
+using persistent_file_queue::test::ToBytes;
+using persistent_file_queue::test::ToString;
+
+namespace {
+
+class AsyncQueueTest : public test::QueueTest {
+protected:
+    AsyncQueueTest() : QueueTest("async_queue", "test_async_storage", "test_async_logs") {}
+};
+
+// 立即开始执行、结束后自行销毁的协程
+struct DetachedTask {
+    struct promise_type {
+        DetachedTask get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+// 手动执行的执行器，便于在测试中控制协程恢复的时机
+class ManualExecutor : public Executor {
+public:
+    void Post(std::function<void()> task) override {
+        tasks_.push_back(std::move(task));
+    }
+
+    size_t RunAll() {
+        size_t executed = 0;
+        while (!tasks_.empty()) {
+            auto task = std::move(tasks_.front());
+            tasks_.erase(tasks_.begin());
+            task();
+            executed++;
+        }
+        return executed;
+    }
+
+private:
+    std::vector<std::function<void()>> tasks_;
+};
+
+DetachedTask Consume(AsyncQueue& queue, std::vector<std::string>& received) {
+    received.push_back(ToString(co_await queue.AsyncDequeue()));
+}
+
+DetachedTask ConsumeInto(AsyncQueue& queue, std::promise<std::string>& received) {
+    received.set_value(ToString(co_await queue.AsyncDequeue()));
+}
+
+DetachedTask Produce(AsyncQueue& queue, std::string item, bool& result) {
+    const auto data = ToBytes(item);
+    result = co_await queue.AsyncEnqueue(data);
+}
+
+} // namespace
+
+// 测试队列为空时挂起，新记录提交后恢复
+TEST_F(AsyncQueueTest, DequeueWaitsForData) {
+    PersistentQueue queue(queue_name_, MakeOptions());
+    AsyncQueue async_queue(queue);
+
+    std::vector<std::string> received;
+    Consume(async_queue, received);
+    EXPECT_TRUE(received.empty());
+    EXPECT_EQ(async_queue.WaitingCount(), 1);
+
+    EXPECT_TRUE(queue.Enqueue(ToBytes("hello")));
+    ASSERT_EQ(received.size(), 1);
+    EXPECT_EQ(received[0], "hello");
+    EXPECT_EQ(async_queue.WaitingCount(), 0);
+    EXPECT_TRUE(queue.Empty());
+
+    // 队列中已有记录时不挂起
+    EXPECT_TRUE(queue.Enqueue(ToBytes("ready")));
+    Consume(async_queue, received);
+    ASSERT_EQ(received.size(), 2);
+    EXPECT_EQ(received[1], "ready");
+}
+
+// 测试大量等待者通过执行器恢复，每条记录只交给一个等待者
+TEST_F(AsyncQueueTest, ManyWaitersWithExecutor) {
+    PersistentQueue queue(queue_name_, MakeOptions());
+    ManualExecutor executor;
+    AsyncQueue async_queue(queue, &executor);
+
+    const int waiters = 100;
+    std::vector<std::string> received;
+    for (int i = 0; i < waiters; ++i) {
+        Consume(async_queue, received);
+    }
+    EXPECT_EQ(async_queue.WaitingCount(), waiters);
+
+    std::deque<bool> results(waiters, false);
+    for (int i = 0; i < waiters; ++i) {
+        Produce(async_queue, "item" + std::to_string(i), results[i]);
+    }
+    executor.RunAll();
+
+    EXPECT_EQ(std::count(results.begin(), results.end(), true), waiters);
+    EXPECT_EQ(async_queue.WaitingCount(), 0);
+    EXPECT_EQ(received.size(), waiters);
+    EXPECT_EQ(std::set<std::string>(received.begin(), received.end()).size(), waiters);
+    EXPECT_TRUE(queue.Empty());
+}
+
+// 测试异步入队在执行器上执行，完成后返回结果
+TEST_F(AsyncQueueTest, EnqueueRunsOnExecutor) {
+    PersistentQueue queue(queue_name_, MakeOptions());
+    ManualExecutor executor;
+    AsyncQueue async_queue(queue, &executor);
+
+    bool result = false;
+    Produce(async_queue, "async", result);
+    EXPECT_FALSE(result);
+    EXPECT_TRUE(queue.Empty());
+
+    EXPECT_EQ(executor.RunAll(), 1);
+    EXPECT_TRUE(result);
+    auto record = queue.Dequeue();
+    ASSERT_TRUE(record.has_value());
+    EXPECT_EQ(ToString(*record), "async");
+}
+
+// 测试延迟记录到期后由投递线程唤醒挂起的协程，记录写入延迟存储时不唤醒
+TEST_F(AsyncQueueTest, DelayedRecordWakesWaiter) {
+    PersistentQueue queue(queue_name_, MakeOptions());
+    AsyncQueue async_queue(queue);
+
+    std::promise<std::string> received;
+    auto future = received.get_future();
+    ConsumeInto(async_queue, received);
+    EXPECT_EQ(async_queue.WaitingCount(), 1);
+
+    EXPECT_TRUE(queue.EnqueueAt(ToBytes("later"), std::chrono::system_clock::now() + std::chrono::milliseconds(50)));
+    EXPECT_EQ(async_queue.WaitingCount(), 1);
+    ASSERT_EQ(future.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+    EXPECT_EQ(future.get(), "later");
+    EXPECT_EQ(async_queue.WaitingCount(), 0);
+}
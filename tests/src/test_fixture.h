@@ -0,0 +1,59 @@
+#pragma once
+
+#include "persistent_file_queue/persistent_queue.h"
+#include <gtest/gtest.h>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace persistent_file_queue::test {
+
+// 队列测试夹具：每个测试套件使用独立的存储和日志目录，测试前后清理
+class QueueTest : public ::testing::Test {
+protected:
+    QueueTest(std::string queue_name, std::string storage_dir, std::string log_dir)
+        : queue_name_(std::move(queue_name)), storage_dir_(std::move(storage_dir)), log_dir_(std::move(log_dir)) {}
+
+    void SetUp() override {
+        // 确保测试目录不存在
+        std::filesystem::remove_all(storage_dir_);
+        std::filesystem::remove_all(log_dir_);
+    }
+
+    void TearDown() override {
+        // 清理测试目录
+        std::filesystem::remove_all(storage_dir_);
+        std::filesystem::remove_all(log_dir_);
+    }
+
+    // 使用测试目录的队列配置，块大小较小以便测试回绕和扩容
+    QueueOptions MakeOptions() const {
+        QueueOptions options;
+        options.storage_dir = storage_dir_;
+        options.block_size = 64 * 1024;
+        options.log_dir = log_dir_;
+        return options;
+    }
+
+    const std::string queue_name_;
+    const std::string storage_dir_;
+    const std::string log_dir_;
+};
+
+inline std::vector<std::byte> ToBytes(const std::string& str) {
+    std::vector<std::byte> bytes(str.size());
+    std::memcpy(bytes.data(), str.data(), str.size());
+    return bytes;
+}
+
+inline std::string ToString(const std::vector<std::byte>& bytes) {
+    return std::string(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+}
+
+inline std::string ToString(const RecordView& record) {
+    return std::string(reinterpret_cast<const char*>(record.data), record.size);
+}
+
+} // namespace persistent_file_queue::test
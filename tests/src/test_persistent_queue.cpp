@@ -1,9 +1,20 @@
 #include "persistent_file_queue/persistent_queue.h"
 #include <gtest/gtest.h>
+#include <chrono>
 #include <filesystem>
+#include <fstream>
+#include <future>
+#include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 
+#ifdef __linux__
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+#endif
+
 namespace fs = std::filesystem;
 using namespace persistent_file_queue;
 
@@ -33,6 +44,15 @@ protected:
         }
     }
 
+    // 使用测试目录的队列配置
+    QueueOptions MakeOptions() const {
+        QueueOptions options;
+        options.storage_dir = storage_dir_;
+        options.block_size = 64 * 1024 * 1024;
+        options.log_dir = log_dir_;
+        return options;
+    }
+
     const std::string queue_name_ = "test_queue";
     const std::string storage_dir_ = "test_storage";
     const std::string log_dir_ = "test_logs";
@@ -233,6 +253,1007 @@ TEST_F(PersistentQueueTest, DefaultPaths) {
     }
 }
 
+// 测试查看队首数据不出队
+TEST_F(PersistentQueueTest, Peek) {
+    PersistentQueue queue(queue_name_, storage_dir_, 64 * 1024 * 1024, log_dir_);
+    EXPECT_FALSE(queue.Peek().has_value());
+
+    EXPECT_TRUE(queue.Enqueue(StringToBytes("head")));
+    EXPECT_TRUE(queue.Enqueue(StringToBytes("tail")));
+    auto result = queue.Peek();
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(BytesToString(result.value()), "head");
+    EXPECT_EQ(queue.Size(), 2);
+
+    result = queue.Dequeue();
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(BytesToString(result.value()), "head");
+    result = queue.Peek();
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(BytesToString(result.value()), "tail");
+}
+
+// 测试批量出队：记录按顺序原地交给回调，回调返回 false 或抛出异常时停止，读取位置在重新打开后保持
+TEST_F(PersistentQueueTest, ForEachBatch) {
+    QueueOptions options = MakeOptions();
+    options.block_size = 64 * 1024;
+    std::vector<std::string> seen;
+    auto collect = [&seen](const RecordView& record) {
+        seen.emplace_back(reinterpret_cast<const char*>(record.data), record.size);
+        return true;
+    };
+
+    {
+        PersistentQueue queue(queue_name_, options);
+        EXPECT_EQ(queue.ForEach(10, collect), 0);
+        for (int i = 0; i < 100; ++i) {
+            ASSERT_TRUE(queue.Enqueue(StringToBytes("record-" + std::to_string(i))));
+        }
+
+        EXPECT_EQ(queue.ForEach(30, collect, 7), 30);
+        EXPECT_EQ(queue.Size(), 70);
+
+        // 回调返回 false 时该记录不出队
+        EXPECT_EQ(queue.ForEach(100, [&](const RecordView& record) { return seen.size() < 35 && collect(record); }), 5);
+        EXPECT_EQ(queue.Size(), 65);
+
+        // 回调抛出异常时之前处理的记录已出队
+        EXPECT_THROW(queue.ForEach(100, [&](const RecordView& record) {
+            if (seen.size() == 40) {
+                throw std::runtime_error("stop");
+            }
+            return collect(record);
+        }), std::runtime_error);
+        EXPECT_EQ(queue.Size(), 60);
+    }
+
+    PersistentQueue queue(queue_name_, options);
+    EXPECT_EQ(queue.Size(), 60);
+    EXPECT_EQ(queue.ForEach(1000, collect), 60);
+    EXPECT_TRUE(queue.Empty());
+    ASSERT_EQ(seen.size(), 100);
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_EQ(seen[i], "record-" + std::to_string(i));
+    }
+}
+
+// 测试后台巡检：巡检通过的记录在出队时跳过校验
+TEST_F(PersistentQueueTest, ScrubberVerifiesBacklog) {
+    PersistentQueue queue(queue_name_, storage_dir_, 64 * 1024 * 1024, log_dir_);
+
+    std::vector<std::string> test_strings = {"first", "second", "third"};
+    for (const auto& str : test_strings) {
+        EXPECT_TRUE(queue.Enqueue(StringToBytes(str)));
+    }
+    EXPECT_EQ(queue.ScrubbedBytes(), 0);
+
+    queue.StartScrubber({1024 * 1024, std::chrono::milliseconds(10), {}});
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (queue.ScrubbedBytes() < queue.TotalBytes() && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    EXPECT_EQ(queue.ScrubbedBytes(), queue.TotalBytes());
+
+    // 出队消耗已巡检的范围
+    auto result = queue.Dequeue();
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(BytesToString(result.value()), test_strings[0]);
+    EXPECT_EQ(queue.ScrubbedBytes(), queue.TotalBytes());
+    queue.StopScrubber();
+
+    for (size_t i = 1; i < test_strings.size(); ++i) {
+        result = queue.Dequeue();
+        ASSERT_TRUE(result.has_value());
+        EXPECT_EQ(BytesToString(result.value()), test_strings[i]);
+    }
+    EXPECT_EQ(queue.ScrubbedBytes(), 0);
+}
+
+// 测试后台巡检发现损坏记录
+TEST_F(PersistentQueueTest, ScrubberReportsCorruption) {
+    const size_t block_size = 64 * 1024 * 1024;
+    PersistentQueue queue(queue_name_, storage_dir_, block_size, log_dir_);
+    EXPECT_TRUE(queue.Enqueue(StringToBytes("intact")));
+    EXPECT_TRUE(queue.Enqueue(StringToBytes("corrupted")));
+
+    // 直接修改文件中第二条记录的数据
+    {
+        std::fstream file(fs::path(storage_dir_) / (queue_name_ + ".dat"),
+                          std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(block_size + CalculateTotalSize(6) + sizeof(uint32_t));
+        file.put('X');
+    }
+
+    std::promise<uint64_t> corrupted;
+    auto corrupted_offset = corrupted.get_future();
+    ScrubberOptions options;
+    options.idle_interval = std::chrono::milliseconds(10);
+    options.on_corruption = [&corrupted](uint64_t offset, std::string_view) { corrupted.set_value(offset); };
+    queue.StartScrubber(options);
+
+    ASSERT_EQ(corrupted_offset.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+    EXPECT_EQ(corrupted_offset.get(), block_size + CalculateTotalSize(6));
+    EXPECT_EQ(queue.ScrubbedBytes(), CalculateTotalSize(6));
+    queue.StopScrubber();
+
+    // 损坏记录之前的数据可以正常出队，损坏记录仍在出队时被检测到
+    auto result = queue.Dequeue();
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(BytesToString(result.value()), "intact");
+    EXPECT_THROW(queue.Dequeue(), std::runtime_error);
+}
+
+// 辅助函数：修改队列文件中指定偏移量的一个字节
+void CorruptByte(const fs::path& file_path, size_t offset, char value) {
+    std::fstream file(file_path, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(offset);
+    file.put(value);
+}
+
+// 测试损坏处理策略：跳过并计数
+TEST_F(PersistentQueueTest, CorruptionPolicySkip) {
+    QueueOptions options = MakeOptions();
+    options.corruption_policy = CorruptionPolicy::kSkip;
+    PersistentQueue queue(queue_name_, options);
+
+    EXPECT_TRUE(queue.Enqueue(StringToBytes("bad")));
+    EXPECT_TRUE(queue.Enqueue(StringToBytes("good")));
+    CorruptByte(fs::path(storage_dir_) / (queue_name_ + ".dat"), options.block_size + sizeof(uint32_t), 'X');
+
+    auto result = queue.Dequeue();
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(BytesToString(result.value()), "good");
+    EXPECT_TRUE(queue.Empty());
+
+    CorruptionStats stats = queue.GetCorruptionStats();
+    EXPECT_EQ(stats.detected, 1);
+    EXPECT_EQ(stats.skipped, 1);
+    EXPECT_EQ(stats.quarantined, 0);
+}
+
+// 测试损坏处理策略：写入隔离文件
+TEST_F(PersistentQueueTest, CorruptionPolicyQuarantine) {
+    QueueOptions options = MakeOptions();
+    options.corruption_policy = CorruptionPolicy::kQuarantine;
+    PersistentQueue queue(queue_name_, options);
+
+    EXPECT_TRUE(queue.Enqueue(StringToBytes("good")));
+    EXPECT_TRUE(queue.Enqueue(StringToBytes("bad")));
+    const size_t bad_offset = options.block_size + CalculateTotalSize(4);
+    CorruptByte(fs::path(storage_dir_) / (queue_name_ + ".dat"), bad_offset + sizeof(uint32_t), 'X');
+
+    auto result = queue.Dequeue();
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(BytesToString(result.value()), "good");
+    EXPECT_FALSE(queue.Dequeue().has_value());
+
+    CorruptionStats stats = queue.GetCorruptionStats();
+    EXPECT_EQ(stats.detected, 1);
+    EXPECT_EQ(stats.skipped, 1);
+    EXPECT_EQ(stats.quarantined, 1);
+
+    // 隔离文件包含偏移量、长度和原始记录
+    std::ifstream quarantine(fs::path(storage_dir_) / (queue_name_ + ".quarantine"), std::ios::binary);
+    ASSERT_TRUE(quarantine.is_open());
+    uint64_t offset = 0;
+    uint32_t record_size = 0;
+    quarantine.read(reinterpret_cast<char*>(&offset), sizeof(offset));
+    quarantine.read(reinterpret_cast<char*>(&record_size), sizeof(record_size));
+    EXPECT_EQ(offset, bad_offset);
+    EXPECT_EQ(record_size, 3 + sizeof(std::byte));
+    std::string payload(3, '\0');
+    quarantine.read(payload.data(), payload.size());
+    EXPECT_EQ(payload, "Xad");
+}
+
+// 测试长度字段损坏：默认策略抛出异常，跳过策略丢弃无法解析的剩余数据
+TEST_F(PersistentQueueTest, CorruptionPolicyInvalidSize) {
+    const fs::path file_path = fs::path(storage_dir_) / (queue_name_ + ".dat");
+    const size_t block_size = 64 * 1024 * 1024;
+    {
+        PersistentQueue queue(queue_name_, storage_dir_, block_size, log_dir_);
+        EXPECT_TRUE(queue.Enqueue(StringToBytes("first")));
+        EXPECT_TRUE(queue.Enqueue(StringToBytes("second")));
+        CorruptByte(file_path, block_size + 3, '\x7F');
+        EXPECT_THROW(queue.Dequeue(), std::runtime_error);
+        EXPECT_EQ(queue.Size(), 2);
+    }
+    fs::remove(file_path);
+
+    QueueOptions options = MakeOptions();
+    options.corruption_policy = CorruptionPolicy::kSkip;
+    PersistentQueue queue(queue_name_, options);
+    EXPECT_TRUE(queue.Enqueue(StringToBytes("first")));
+    EXPECT_TRUE(queue.Enqueue(StringToBytes("second")));
+    CorruptByte(file_path, block_size + 3, '\x7F');
+    EXPECT_FALSE(queue.Dequeue().has_value());
+    EXPECT_TRUE(queue.Empty());
+    EXPECT_EQ(queue.TotalBytes(), 0);
+    EXPECT_EQ(queue.GetCorruptionStats().skipped, 2);
+}
+
+// 测试多目录条带：块轮流分布到多个目录，跨块记录可以正确读写并在重启后恢复
+TEST_F(PersistentQueueTest, StripedAcrossDirectories) {
+    QueueOptions options = MakeOptions();
+    options.block_size = 64 * 1024;
+    options.stripe_dirs = {storage_dir_ + "/disk1", storage_dir_ + "/disk2"};
+
+    std::vector<std::string> records;
+    for (int i = 0; i < 20; ++i) {
+        records.push_back(std::string(20000 + i, static_cast<char>('a' + i)));
+    }
+    {
+        PersistentQueue queue(queue_name_, options);
+        for (const auto& record : records) {
+            EXPECT_TRUE(queue.Enqueue(StringToBytes(record)));
+        }
+    }
+    EXPECT_TRUE(fs::exists(fs::path(storage_dir_) / "disk1" / (queue_name_ + ".stripe1.dat")));
+    EXPECT_TRUE(fs::exists(fs::path(storage_dir_) / "disk2" / (queue_name_ + ".stripe2.dat")));
+
+    // 条带目录与创建时不一致时拒绝打开
+    QueueOptions mismatched = options;
+    mismatched.stripe_dirs.pop_back();
+    EXPECT_THROW(PersistentQueue(queue_name_, mismatched), std::runtime_error);
+
+    PersistentQueue queue(queue_name_, options);
+    EXPECT_EQ(queue.Size(), records.size());
+    for (const auto& expected : records) {
+        auto result = queue.Dequeue();
+        ASSERT_TRUE(result.has_value());
+        EXPECT_EQ(BytesToString(result.value()), expected);
+    }
+    EXPECT_TRUE(queue.Empty());
+}
+
+// 测试优先级通道：高优先级通道优先出队，重启后保留各通道数据
+TEST_F(PersistentQueueTest, PriorityLanes) {
+    QueueOptions options = MakeOptions();
+    options.block_size = 64 * 1024;
+    options.priority_lanes = 3;
+    {
+        PersistentQueue queue(queue_name_, options);
+        EXPECT_TRUE(queue.Enqueue(StringToBytes("bulk-1")));
+        EXPECT_TRUE(queue.Enqueue(StringToBytes("bulk-2"), 0));
+        EXPECT_TRUE(queue.Enqueue(StringToBytes("normal"), 1));
+        EXPECT_TRUE(queue.Enqueue(StringToBytes("control"), 2));
+        EXPECT_THROW(queue.Enqueue(StringToBytes("invalid"), 3), std::out_of_range);
+        EXPECT_EQ(queue.Size(), 4);
+        EXPECT_EQ(queue.LaneSize(0), 2);
+        EXPECT_EQ(queue.LaneSize(2), 1);
+        EXPECT_EQ(queue.TotalBytes(), CalculateTotalSize(6) * 2 + CalculateTotalSize(6) + CalculateTotalSize(7));
+    }
+
+    // 通道数与创建时不一致时拒绝打开
+    QueueOptions mismatched = options;
+    mismatched.priority_lanes = 2;
+    EXPECT_THROW(PersistentQueue(queue_name_, mismatched), std::runtime_error);
+
+    PersistentQueue queue(queue_name_, options);
+    auto result = queue.Peek();
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(BytesToString(result.value()), "control");
+    for (const std::string expected : {"control", "normal", "bulk-1", "bulk-2"}) {
+        result = queue.Dequeue();
+        ASSERT_TRUE(result.has_value());
+        EXPECT_EQ(BytesToString(result.value()), expected);
+    }
+    EXPECT_TRUE(queue.Empty());
+    EXPECT_EQ(queue.TotalBytes(), 0);
+}
+
+// 测试优先级通道的防饥饿：低优先级通道在被连续跳过指定次数后出队一次
+TEST_F(PersistentQueueTest, PriorityLaneStarvationLimit) {
+    QueueOptions options = MakeOptions();
+    options.block_size = 64 * 1024;
+    options.priority_lanes = 2;
+    options.lane_starvation_limit = 2;
+    PersistentQueue queue(queue_name_, options);
+
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_TRUE(queue.Enqueue(StringToBytes("low" + std::to_string(i)), 0));
+        EXPECT_TRUE(queue.Enqueue(StringToBytes("high" + std::to_string(i)), 1));
+    }
+    for (const std::string expected : {"high0", "high1", "low0", "high2", "low1", "low2"}) {
+        auto result = queue.Dequeue();
+        ASSERT_TRUE(result.has_value());
+        EXPECT_EQ(BytesToString(result.value()), expected);
+    }
+    EXPECT_TRUE(queue.Empty());
+}
+
+// 测试延迟记录到期前不可见，到期后按投递时间顺序出队
+TEST_F(PersistentQueueTest, DelayedDelivery) {
+    PersistentQueue queue(queue_name_, MakeOptions());
+    const auto now = std::chrono::system_clock::now();
+    EXPECT_TRUE(queue.EnqueueAt(StringToBytes("later"), now + std::chrono::milliseconds(400)));
+    EXPECT_TRUE(queue.EnqueueAt(StringToBytes("sooner"), now + std::chrono::milliseconds(200)));
+    EXPECT_TRUE(queue.EnqueueAt(StringToBytes("now"), now));
+    EXPECT_EQ(queue.DelayedSize(), 2);
+
+    auto result = queue.Dequeue();
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(BytesToString(result.value()), "now");
+    EXPECT_FALSE(queue.Dequeue().has_value());
+
+    std::this_thread::sleep_until(now + std::chrono::milliseconds(450));
+    for (const std::string expected : {"sooner", "later"}) {
+        result = queue.Dequeue();
+        ASSERT_TRUE(result.has_value());
+        EXPECT_EQ(BytesToString(result.value()), expected);
+    }
+    EXPECT_EQ(queue.DelayedSize(), 0);
+    EXPECT_TRUE(queue.Empty());
+}
+
+// 测试延迟记录在重新打开队列后仍然保留，投递后不会重复出现
+TEST_F(PersistentQueueTest, DelayedDeliverySurvivesReopen) {
+    const auto deliver_at = std::chrono::system_clock::now() + std::chrono::milliseconds(300);
+    {
+        PersistentQueue queue(queue_name_, MakeOptions());
+        EXPECT_TRUE(queue.EnqueueAt(StringToBytes("delayed"), deliver_at));
+        EXPECT_TRUE(queue.Enqueue(StringToBytes("ready")));
+    }
+    {
+        PersistentQueue queue(queue_name_, MakeOptions());
+        EXPECT_EQ(queue.DelayedSize(), 1);
+        auto result = queue.Dequeue();
+        ASSERT_TRUE(result.has_value());
+        EXPECT_EQ(BytesToString(result.value()), "ready");
+
+        std::this_thread::sleep_until(deliver_at + std::chrono::milliseconds(50));
+        result = queue.Peek();
+        ASSERT_TRUE(result.has_value());
+        EXPECT_EQ(BytesToString(result.value()), "delayed");
+        EXPECT_EQ(queue.DelayedSize(), 0);
+    }
+
+    PersistentQueue queue(queue_name_, MakeOptions());
+    EXPECT_EQ(queue.DelayedSize(), 0);
+    EXPECT_EQ(queue.Size(), 1);
+    EXPECT_TRUE(fs::is_empty(fs::path(storage_dir_) / (queue_name_ + ".delay")));
+}
+
+// 测试同一时间桶部分转出后追加的记录在重新打开后既不丢失也不重复
+TEST_F(PersistentQueueTest, DelayedPartialPromotionSurvivesReopen) {
+    auto options = MakeOptions();
+    options.delay_bucket_interval = std::chrono::hours(1);
+    const auto now = std::chrono::system_clock::now();
+    {
+        PersistentQueue queue(queue_name_, options);
+        EXPECT_TRUE(queue.EnqueueAt(StringToBytes("first"), now + std::chrono::milliseconds(100)));
+        EXPECT_TRUE(queue.EnqueueAt(StringToBytes("third"), now + std::chrono::milliseconds(600)));
+        std::this_thread::sleep_until(now + std::chrono::milliseconds(150));
+        auto result = queue.Dequeue();
+        ASSERT_TRUE(result.has_value());
+        EXPECT_EQ(BytesToString(result.value()), "first");
+        EXPECT_TRUE(queue.EnqueueAt(StringToBytes("second"), now + std::chrono::milliseconds(400)));
+        EXPECT_EQ(queue.DelayedSize(), 2);
+    }
+
+    PersistentQueue queue(queue_name_, options);
+    EXPECT_EQ(queue.DelayedSize(), 2);
+    EXPECT_FALSE(queue.Dequeue().has_value());
+    std::this_thread::sleep_until(now + std::chrono::milliseconds(650));
+    for (const std::string expected : {"second", "third"}) {
+        auto result = queue.Dequeue();
+        ASSERT_TRUE(result.has_value());
+        EXPECT_EQ(BytesToString(result.value()), expected);
+    }
+    EXPECT_FALSE(queue.Dequeue().has_value());
+    EXPECT_EQ(queue.DelayedSize(), 0);
+}
+
+// 测试租约模式：确认后读取位置越过连续已确认的记录，超时未确认的记录以新的租约标识重新投递
+TEST_F(PersistentQueueTest, LeaseAckAndRedelivery) {
+    QueueOptions options = MakeOptions();
+    options.visibility_timeout = std::chrono::milliseconds(200);
+    PersistentQueue queue(queue_name_, options);
+    for (const std::string item : {"a", "b", "c"}) {
+        EXPECT_TRUE(queue.Enqueue(StringToBytes(item)));
+    }
+
+    auto first = queue.Receive();
+    auto second = queue.Receive();
+    ASSERT_TRUE(first.has_value());
+    ASSERT_TRUE(second.has_value());
+    EXPECT_EQ(BytesToString(first->data), "a");
+    EXPECT_EQ(BytesToString(second->data), "b");
+    EXPECT_EQ(queue.LeasedCount(), 2);
+    EXPECT_THROW(queue.Dequeue(), std::logic_error);
+
+    // 前面的记录未确认时读取位置不变
+    EXPECT_TRUE(queue.Ack(second->lease_id));
+    EXPECT_FALSE(queue.Ack(second->lease_id));
+    EXPECT_EQ(queue.Size(), 3);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(250));
+    auto redelivered = queue.Receive();
+    ASSERT_TRUE(redelivered.has_value());
+    EXPECT_EQ(BytesToString(redelivered->data), "a");
+    EXPECT_NE(redelivered->lease_id, first->lease_id);
+
+    // 重新投递后，原租约持有者迟到的确认被拒绝，记录仍由新租约持有
+    EXPECT_FALSE(queue.Ack(first->lease_id));
+    EXPECT_EQ(queue.Size(), 3);
+    EXPECT_EQ(queue.LeasedCount(), 1);
+    EXPECT_TRUE(queue.Ack(redelivered->lease_id));
+    EXPECT_EQ(queue.Size(), 1);
+
+    auto third = queue.Receive();
+    ASSERT_TRUE(third.has_value());
+    EXPECT_EQ(BytesToString(third->data), "c");
+    EXPECT_FALSE(queue.Receive().has_value());
+    EXPECT_TRUE(queue.Ack(third->lease_id));
+    EXPECT_EQ(queue.LeasedCount(), 0);
+    EXPECT_TRUE(queue.Empty());
+    EXPECT_FALSE(queue.Dequeue().has_value());
+}
+
+// 测试未确认的记录在重新打开队列后重新投递
+TEST_F(PersistentQueueTest, LeaseRedeliveredAfterReopen) {
+    {
+        PersistentQueue queue(queue_name_, MakeOptions());
+        EXPECT_TRUE(queue.Enqueue(StringToBytes("first")));
+        EXPECT_TRUE(queue.Enqueue(StringToBytes("second")));
+        auto first = queue.Receive();
+        ASSERT_TRUE(first.has_value());
+        EXPECT_TRUE(queue.Ack(first->lease_id));
+        auto second = queue.Receive();
+        ASSERT_TRUE(second.has_value());
+        EXPECT_EQ(BytesToString(second->data), "second");
+    }
+
+    PersistentQueue queue(queue_name_, MakeOptions());
+    EXPECT_EQ(queue.Size(), 1);
+    auto result = queue.Receive();
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(BytesToString(result->data), "second");
+    EXPECT_TRUE(queue.Ack(result->lease_id));
+    EXPECT_TRUE(queue.Empty());
+}
+
+// 测试事务提交后记录同时可见，未提交的事务被丢弃
+TEST_F(PersistentQueueTest, TransactionCommit) {
+    {
+        PersistentQueue queue(queue_name_, MakeOptions());
+        auto txn = queue.BeginTxn();
+        for (int i = 0; i < 3; ++i) {
+            txn.Append(StringToBytes("txn" + std::to_string(i)));
+        }
+        EXPECT_EQ(txn.Size(), 3);
+        EXPECT_TRUE(queue.Empty());
+        EXPECT_TRUE(queue.CommitTxn(txn));
+        EXPECT_EQ(txn.Size(), 0);
+        EXPECT_EQ(queue.Size(), 3);
+
+        // 未提交的事务不产生任何可见记录
+        auto aborted = queue.BeginTxn();
+        aborted.Append(StringToBytes("aborted"));
+    }
+
+    PersistentQueue queue(queue_name_, MakeOptions());
+    EXPECT_EQ(queue.Size(), 3);
+    for (int i = 0; i < 3; ++i) {
+        auto result = queue.Dequeue();
+        ASSERT_TRUE(result.has_value());
+        EXPECT_EQ(BytesToString(result.value()), "txn" + std::to_string(i));
+    }
+    EXPECT_TRUE(queue.Empty());
+}
+
+// 测试生产者表已满：新的生产者被拒绝，移除生产者后槽位可以复用，其余生产者的状态不受影响
+TEST_F(PersistentQueueTest, ProducerTableFull) {
+    constexpr uint64_t slots = PersistentQueue::MAX_PRODUCERS;
+    // 生产者标识按槽数取模同余，全部落在同一条探测序列上
+    const auto producer = [&](uint64_t index) { return (index + 1) * slots + 1; };
+    {
+        PersistentQueue queue(queue_name_, MakeOptions());
+        for (uint64_t i = 0; i < slots; ++i) {
+            EXPECT_EQ(queue.EnqueueIdempotent(producer(i), i, StringToBytes("r")), EnqueueStatus::kEnqueued);
+        }
+        EXPECT_THROW(queue.EnqueueIdempotent(producer(slots), 0, StringToBytes("r")), std::runtime_error);
+
+        EXPECT_TRUE(queue.RemoveProducer(producer(10)));
+        EXPECT_FALSE(queue.RemoveProducer(producer(10)));
+        EXPECT_FALSE(queue.RemoveProducer(producer(slots)));
+        EXPECT_FALSE(queue.LastSequence(producer(10)).has_value());
+        EXPECT_EQ(queue.EnqueueIdempotent(producer(slots), 0, StringToBytes("r")), EnqueueStatus::kEnqueued);
+    }
+
+    PersistentQueue queue(queue_name_, MakeOptions());
+    for (uint64_t i = 0; i < slots; ++i) {
+        if (i != 10) {
+            EXPECT_EQ(queue.LastSequence(producer(i)), i);
+            EXPECT_EQ(queue.EnqueueIdempotent(producer(i), i, StringToBytes("r")), EnqueueStatus::kDuplicate);
+        }
+    }
+    EXPECT_EQ(queue.LastSequence(producer(slots)), 0);
+    EXPECT_THROW(queue.EnqueueIdempotent(producer(10), 10, StringToBytes("r")), std::runtime_error);
+}
+
+// 测试幂等入队：重试的序列号被拒绝，生产者状态在重新打开后保留
+TEST_F(PersistentQueueTest, IdempotentProducer) {
+    {
+        PersistentQueue queue(queue_name_, MakeOptions());
+        EXPECT_FALSE(queue.LastSequence(7).has_value());
+        EXPECT_EQ(queue.EnqueueIdempotent(7, 1, StringToBytes("p7-1")), EnqueueStatus::kEnqueued);
+        EXPECT_EQ(queue.EnqueueIdempotent(7, 1, StringToBytes("p7-1")), EnqueueStatus::kDuplicate);
+        EXPECT_EQ(queue.EnqueueIdempotent(9, 1, StringToBytes("p9-1")), EnqueueStatus::kEnqueued);
+        EXPECT_EQ(queue.EnqueueIdempotent(7, 3, StringToBytes("p7-3")), EnqueueStatus::kEnqueued);
+        EXPECT_THROW(queue.EnqueueIdempotent(0, 1, StringToBytes("invalid")), std::invalid_argument);
+    }
+
+    PersistentQueue queue(queue_name_, MakeOptions());
+    EXPECT_EQ(queue.LastSequence(7), 3);
+    EXPECT_EQ(queue.LastSequence(9), 1);
+    EXPECT_EQ(queue.EnqueueIdempotent(7, 2, StringToBytes("p7-2")), EnqueueStatus::kDuplicate);
+    EXPECT_EQ(queue.EnqueueIdempotent(7, 4, StringToBytes("p7-4")), EnqueueStatus::kEnqueued);
+    for (const std::string expected : {"p7-1", "p9-1", "p7-3", "p7-4"}) {
+        auto result = queue.Dequeue();
+        ASSERT_TRUE(result.has_value());
+        EXPECT_EQ(BytesToString(result.value()), expected);
+    }
+    EXPECT_TRUE(queue.Empty());
+}
+
+// 测试快照：条带队列导出为单个队列文件，只包含快照时读写位置之间的记录
+TEST_F(PersistentQueueTest, Snapshot) {
+    QueueOptions options = MakeOptions();
+    options.block_size = 64 * 1024;
+    options.stripe_dirs = {storage_dir_ + "/disk1"};
+    const fs::path snapshot_dir = fs::path(storage_dir_) / "snapshot";
+    fs::create_directories(snapshot_dir);
+    const std::string snapshot_path = (snapshot_dir / (queue_name_ + ".dat")).string();
+
+    std::vector<std::string> records;
+    for (int i = 0; i < 30; ++i) {
+        records.push_back(std::string(5000 + i, static_cast<char>('a' + i % 26)));
+    }
+    PersistentQueue queue(queue_name_, options);
+    for (const auto& record : records) {
+        ASSERT_TRUE(queue.Enqueue(StringToBytes(record)));
+    }
+    for (int i = 0; i < 10; ++i) {
+        ASSERT_TRUE(queue.Dequeue().has_value());
+    }
+    EXPECT_EQ(queue.Snapshot(snapshot_path), 20);
+    EXPECT_FALSE(fs::exists(snapshot_path + ".tmp"));
+    EXPECT_TRUE(queue.Enqueue(StringToBytes("after snapshot")));
+
+    QueueOptions snapshot_options = MakeOptions();
+    snapshot_options.block_size = options.block_size;
+    snapshot_options.storage_dir = snapshot_dir.string();
+    PersistentQueue restored(queue_name_, snapshot_options);
+    EXPECT_EQ(restored.Size(), 20);
+    for (int i = 10; i < 30; ++i) {
+        auto result = restored.Dequeue();
+        ASSERT_TRUE(result.has_value());
+        EXPECT_EQ(BytesToString(result.value()), records[i]);
+    }
+    EXPECT_TRUE(restored.Empty());
+}
+
+// 测试延迟打开：新文件按需扩展，重新打开时不校验积压记录，损坏在出队时才被发现
+TEST_F(PersistentQueueTest, LazyOpen) {
+    QueueOptions options = MakeOptions();
+    options.block_size = 64 * 1024;
+    options.lazy_open = true;
+    const fs::path file_path = fs::path(storage_dir_) / (queue_name_ + ".dat");
+    const std::vector<std::byte> record(1000, std::byte{'x'});
+    {
+        PersistentQueue queue(queue_name_, options);
+        EXPECT_EQ(fs::file_size(file_path), 2 * options.block_size);
+        EXPECT_TRUE(queue.Enqueue(StringToBytes("first")));
+        for (int i = 0; i < 200; ++i) {
+            ASSERT_TRUE(queue.Enqueue(record));
+        }
+        EXPECT_GT(fs::file_size(file_path), 2 * options.block_size);
+    }
+
+    // 损坏最后一条记录：默认模式在打开时发现，延迟打开时只在读到该记录时发现
+    CorruptByte(file_path, options.block_size + CalculateTotalSize(5) + 199 * CalculateTotalSize(1000) + 10, 'Y');
+    options.lazy_open = false;
+    EXPECT_THROW(PersistentQueue(queue_name_, options), std::runtime_error);
+
+    options.lazy_open = true;
+    PersistentQueue queue(queue_name_, options);
+    EXPECT_EQ(queue.Size(), 201);
+    auto result = queue.Dequeue();
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(BytesToString(result.value()), "first");
+    for (int i = 0; i < 199; ++i) {
+        ASSERT_TRUE(queue.Dequeue().has_value());
+    }
+    EXPECT_THROW(queue.Dequeue(), std::runtime_error);
+}
+
+// 测试压缩：积压位于文件后部时提前回绕，消费越过回绕点后收缩文件，记录顺序不变
+TEST_F(PersistentQueueTest, CompactShrinksFile) {
+    QueueOptions options = MakeOptions();
+    options.block_size = 64 * 1024;
+    options.lazy_open = true;
+    const fs::path file_path = fs::path(storage_dir_) / (queue_name_ + ".dat");
+    auto make_record = [](int i) {
+        std::string record = "rec" + std::to_string(i);
+        record.resize(1000, '.');
+        return StringToBytes(record);
+    };
+    auto expect_record = [&](PersistentQueue& queue, int i) {
+        auto result = queue.Dequeue();
+        ASSERT_TRUE(result.has_value());
+        EXPECT_EQ(BytesToString(result.value()), BytesToString(make_record(i)));
+    };
+
+    {
+        PersistentQueue queue(queue_name_, options);
+        for (int i = 0; i < 300; ++i) {
+            ASSERT_TRUE(queue.Enqueue(make_record(i)));
+        }
+        const size_t grown_size = fs::file_size(file_path);
+        EXPECT_EQ(grown_size, 8 * options.block_size);
+        for (int i = 0; i < 250; ++i) {
+            expect_record(queue, i);
+        }
+
+        // 第一步只提前回绕，新记录写到文件前部
+        EXPECT_EQ(queue.Compact(), 0);
+        for (int i = 300; i < 310; ++i) {
+            ASSERT_TRUE(queue.Enqueue(make_record(i)));
+        }
+        EXPECT_EQ(queue.Compact(), 0);  // 读取位置尚未越过回绕点
+        for (int i = 250; i < 305; ++i) {
+            expect_record(queue, i);
+        }
+
+        EXPECT_EQ(queue.Compact(), grown_size - 2 * options.block_size);
+        EXPECT_EQ(fs::file_size(file_path), 2 * options.block_size);
+        EXPECT_EQ(queue.Size(), 5);
+    }
+
+    // 收缩后的文件可以正常恢复并继续扩展
+    options.lazy_open = false;
+    PersistentQueue queue(queue_name_, options);
+    for (int i = 310; i < 400; ++i) {
+        ASSERT_TRUE(queue.Enqueue(make_record(i)));
+    }
+    for (int i = 305; i < 400; ++i) {
+        expect_record(queue, i);
+    }
+    EXPECT_TRUE(queue.Empty());
+    EXPECT_GT(queue.Compact(), 0);
+    EXPECT_EQ(fs::file_size(file_path), 2 * options.block_size);
+}
+
+// 测试收缩前要求的空闲时间
+TEST_F(PersistentQueueTest, ShrinkAfterIdle) {
+    QueueOptions options = MakeOptions();
+    options.block_size = 64 * 1024;
+    options.shrink_idle_time = std::chrono::milliseconds(50);
+    const fs::path file_path = fs::path(storage_dir_) / (queue_name_ + ".dat");
+    PersistentQueue queue(queue_name_, options);
+    EXPECT_TRUE(queue.Enqueue(StringToBytes("burst")));
+    EXPECT_TRUE(queue.Dequeue().has_value());
+
+    const size_t full_size = fs::file_size(file_path);
+    EXPECT_EQ(queue.Compact(), 0);  // 刚有读写，不收缩
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    EXPECT_EQ(queue.Compact(), full_size - 2 * options.block_size);
+    EXPECT_EQ(fs::file_size(file_path), 2 * options.block_size);
+}
+
+// 测试打开已有文件时使用头部记录的块大小，配置的块大小只用于新文件
+TEST_F(PersistentQueueTest, BlockSizeFromHeader) {
+    QueueOptions options = MakeOptions();
+    options.block_size = 64 * 1024;
+    const std::vector<std::byte> large(100000, std::byte{'x'});
+    {
+        PersistentQueue queue(queue_name_, options);
+        EXPECT_TRUE(queue.Enqueue(StringToBytes("first")));
+        EXPECT_TRUE(queue.Enqueue(large));
+    }
+
+    options.block_size = 128 * 1024;
+    {
+        PersistentQueue queue(queue_name_, options);
+        EXPECT_EQ(BytesToString(queue.Dequeue().value()), "first");
+        EXPECT_TRUE(queue.Enqueue(large));
+    }
+    options.block_size = 4096;
+    PersistentQueue queue(queue_name_, options);
+    EXPECT_EQ(queue.Dequeue().value(), large);
+    EXPECT_EQ(queue.Dequeue().value(), large);
+    EXPECT_TRUE(queue.Empty());
+}
+
+// 测试缓存行对齐的记录：每条记录占用整数个缓存行，对齐填充计入 TotalBytes，重新打开时按头部中的对齐读取
+TEST_F(PersistentQueueTest, RecordAlignment) {
+    QueueOptions options = MakeOptions();
+    options.block_size = 64 * 1024;
+    options.record_alignment = 64;
+    {
+        PersistentQueue queue(queue_name_, options);
+        EXPECT_TRUE(queue.Enqueue(StringToBytes("a")));
+        EXPECT_TRUE(queue.Enqueue(std::vector<std::byte>(59, std::byte{'b'})));  // 大小字段和校验和后恰好 64 字节
+        EXPECT_TRUE(queue.Enqueue(std::vector<std::byte>(100, std::byte{'c'})));
+        EXPECT_EQ(queue.TotalBytes(), 64 + 64 + 128);
+    }
+
+    options.record_alignment = 0;
+    {
+        PersistentQueue queue(queue_name_, options);
+        EXPECT_EQ(queue.TotalBytes(), 256);
+        EXPECT_EQ(BytesToString(queue.Dequeue().value()), "a");
+        EXPECT_EQ(queue.Dequeue().value(), std::vector<std::byte>(59, std::byte{'b'}));
+        EXPECT_EQ(queue.Dequeue().value(), std::vector<std::byte>(100, std::byte{'c'}));
+    }
+
+    options.format_version = PersistentQueue::LATEST_FORMAT_VERSION;
+    options.record_alignment = 128;
+    PersistentQueue aligned("aligned_v2", options);
+    EXPECT_TRUE(aligned.Enqueue(StringToBytes("x")));
+    EXPECT_EQ(aligned.TotalBytes(), 128);
+    EXPECT_EQ(BytesToString(aligned.Dequeue().value()), "x");
+
+    options.record_alignment = 48;
+    EXPECT_THROW(PersistentQueue("invalid", options), std::invalid_argument);
+}
+
+// 测试按记录大小分布推荐块大小
+TEST_F(PersistentQueueTest, RecommendBlockSize) {
+    RecordSizeStats stats;
+    EXPECT_EQ(PersistentQueue::RecommendBlockSize(stats), PersistentQueue::DEFAULT_BLOCK_SIZE);
+    stats.buckets[6] = 1000;  // 64 字节的事件
+    EXPECT_EQ(PersistentQueue::RecommendBlockSize(stats), 64 * 1024);
+    stats.buckets[9] = 1000;  // 一半为 512 字节的记录
+    EXPECT_EQ(PersistentQueue::RecommendBlockSize(stats), 256 * 1024);
+    stats.buckets[20] = 1000;  // 三分之一为 1MB 的记录
+    EXPECT_EQ(PersistentQueue::RecommendBlockSize(stats), PersistentQueue::DEFAULT_BLOCK_SIZE);
+}
+
+// 测试记录大小分布随头部持久化，空闲的空队列按分布调整块大小后仍可正常读写和重新打开
+TEST_F(PersistentQueueTest, AdaptiveBlockSize) {
+    QueueOptions options = MakeOptions();
+    options.adaptive_block_size = true;
+    const fs::path file_path = fs::path(storage_dir_) / (queue_name_ + ".dat");
+    const std::vector<std::byte> event(64, std::byte{'e'});
+    {
+        PersistentQueue queue(queue_name_, options);
+        auto txn = queue.BeginTxn();
+        for (int i = 0; i < 2000; ++i) {
+            txn.Append(event);
+        }
+        EXPECT_TRUE(queue.CommitTxn(txn));
+        queue.Compact();  // 队列非空时只收缩文件，不调整块大小
+        EXPECT_EQ(fs::file_size(file_path), 2 * options.block_size);
+    }
+
+    {
+        PersistentQueue queue(queue_name_, options);
+        EXPECT_EQ(queue.GetRecordSizeStats().buckets[6], 2000);
+        EXPECT_EQ(queue.ForEach(2000, [](const RecordView&) { return true; }), 2000);
+        EXPECT_GT(queue.Compact(), 0);
+        EXPECT_EQ(fs::file_size(file_path), 2 * 64 * 1024);
+
+        // 调整后按需扩展，记录跨越多个新块
+        for (int i = 0; i < 5000; ++i) {
+            ASSERT_TRUE(queue.Enqueue(StringToBytes("event-" + std::to_string(i))));
+        }
+        EXPECT_EQ(BytesToString(queue.Dequeue().value()), "event-0");
+        EXPECT_EQ(queue.Compact(), 0);
+    }
+
+    PersistentQueue queue(queue_name_, options);
+    EXPECT_EQ(queue.Size(), 4999);
+    EXPECT_EQ(queue.GetRecordSizeStats().buckets[3], 5000 - 10);
+    EXPECT_EQ(BytesToString(queue.Dequeue().value()), "event-1");
+}
+
+#ifdef __linux__
+// 测试在完整消费的块上打洞：文件大小不变，占用的磁盘空间减少
+TEST_F(PersistentQueueTest, PunchConsumedBlocks) {
+    QueueOptions options = MakeOptions();
+    options.block_size = 64 * 1024;
+    options.punch_consumed_blocks = true;
+    const fs::path file_path = fs::path(storage_dir_) / (queue_name_ + ".dat");
+    auto allocated_bytes = [&file_path] {
+        struct stat st {};
+        stat(file_path.c_str(), &st);
+        return static_cast<size_t>(st.st_blocks) * 512;
+    };
+
+    PersistentQueue queue(queue_name_, options);
+    const std::vector<std::byte> record(1000, std::byte{'p'});
+    for (int i = 0; i < 400; ++i) {
+        ASSERT_TRUE(queue.Enqueue(record));
+    }
+    const size_t file_size = fs::file_size(file_path);
+    const size_t allocated = allocated_bytes();
+    for (int i = 0; i < 390; ++i) {
+        ASSERT_TRUE(queue.Dequeue().has_value());
+    }
+    EXPECT_EQ(fs::file_size(file_path), file_size);
+    EXPECT_LE(allocated_bytes() + 5 * options.block_size, allocated);
+    for (int i = 0; i < 10; ++i) {
+        auto result = queue.Dequeue();
+        ASSERT_TRUE(result.has_value());
+        EXPECT_EQ(result.value(), record);
+    }
+}
+
+// 测试直接 I/O 写入：大小记录混合写入，部分出队后重新打开，顺序和内容保持不变
+TEST_F(PersistentQueueTest, DirectIoRoundTrip) {
+    QueueOptions options = MakeOptions();
+    options.block_size = 64 * 1024;
+    options.direct_io = true;
+
+    std::vector<std::vector<std::byte>> records;
+    for (int i = 0; i < 40; ++i) {
+        const size_t size = i % 10 == 0 ? 1024 * 1024 + 7 : static_cast<size_t>(100 + i * 37);
+        records.emplace_back(size, static_cast<std::byte>('a' + i % 26));
+    }
+
+    {
+        std::unique_ptr<PersistentQueue> queue;
+        try {
+            queue = std::make_unique<PersistentQueue>(queue_name_, options);
+        } catch (const std::runtime_error& e) {
+            GTEST_SKIP() << "Direct I/O unavailable: " << e.what();
+        }
+        for (const auto& record : records) {
+            ASSERT_TRUE(queue->Enqueue(record));
+        }
+        for (int i = 0; i < 15; ++i) {
+            auto result = queue->Dequeue();
+            ASSERT_TRUE(result.has_value());
+            EXPECT_EQ(result.value(), records[i]);
+        }
+    }
+
+    PersistentQueue queue(queue_name_, options);
+    EXPECT_EQ(queue.Size(), records.size() - 15);
+    for (size_t i = 15; i < records.size(); ++i) {
+        auto result = queue.Dequeue();
+        ASSERT_TRUE(result.has_value());
+        EXPECT_EQ(result.value(), records[i]);
+    }
+    EXPECT_FALSE(queue.Dequeue().has_value());
+}
+
+// 测试直接 I/O 模式下空间不足的事务不留下暂存数据：回绕后之后的写入不能覆盖未消费的记录
+TEST_F(PersistentQueueTest, DirectIoFailedTxnKeepsUnconsumedRecord) {
+    QueueOptions options = MakeOptions();
+    options.block_size = 64 * 1024;
+    options.direct_io = true;
+    options.lazy_open = true;
+
+    std::unique_ptr<PersistentQueue> queue;
+    try {
+        queue = std::make_unique<PersistentQueue>(queue_name_, options);
+    } catch (const std::runtime_error& e) {
+        GTEST_SKIP() << "Direct I/O unavailable: " << e.what();
+    }
+    const std::vector<std::byte> record(1000, std::byte{'r'});
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_TRUE(queue->Enqueue(record));
+    }
+    for (int i = 0; i < 99; ++i) {
+        ASSERT_TRUE(queue->Dequeue().has_value());
+    }
+    queue->Compact();
+
+    auto txn = queue->BeginTxn();
+    for (int i = 0; i < 100; ++i) {
+        txn.Append(record);
+    }
+    EXPECT_FALSE(queue->CommitTxn(txn));
+    EXPECT_TRUE(queue->Enqueue(StringToBytes("small")));
+
+    auto result = queue->Dequeue();
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(result.value(), record);
+    EXPECT_EQ(BytesToString(queue->Dequeue().value()), "small");
+    EXPECT_FALSE(queue->Dequeue().has_value());
+}
+
+// 测试纯内存模式：不创建队列文件，接口行为与持久化队列相同，关闭后数据不保留
+TEST_F(PersistentQueueTest, MemoryOnly) {
+    QueueOptions options = MakeOptions();
+    options.block_size = 64 * 1024;
+    options.memory_only = true;
+    {
+        PersistentQueue queue(queue_name_, options);
+        const std::vector<std::byte> large(3 * options.block_size / 2, std::byte{'m'});
+        EXPECT_TRUE(queue.Enqueue(StringToBytes("first")));
+        EXPECT_TRUE(queue.Enqueue(large));
+        EXPECT_TRUE(queue.Enqueue(StringToBytes("last")));
+        EXPECT_EQ(queue.Size(), 3);
+        EXPECT_EQ(BytesToString(queue.Dequeue().value()), "first");
+        EXPECT_EQ(queue.Dequeue().value(), large);
+        EXPECT_EQ(BytesToString(queue.Peek().value()), "last");
+    }
+    EXPECT_FALSE(fs::exists(fs::path(storage_dir_) / (queue_name_ + ".dat")));
+
+    PersistentQueue queue(queue_name_, options);
+    EXPECT_TRUE(queue.Empty());
+
+    options.direct_io = true;
+    EXPECT_THROW(PersistentQueue(queue_name_, options), std::invalid_argument);
+}
+
+// 测试数据通知句柄只在空与非空之间切换时改变可读状态
+TEST_F(PersistentQueueTest, DataAvailableFd) {
+    PersistentQueue queue(queue_name_, MakeOptions());
+    const int fd = queue.DataAvailableFd();
+    EXPECT_EQ(queue.DataAvailableFd(), fd);
+
+    auto readable = [fd] {
+        pollfd pfd{};
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+        return poll(&pfd, 1, 0) == 1 && (pfd.revents & POLLIN) != 0;
+    };
+    EXPECT_FALSE(readable());
+
+    EXPECT_TRUE(queue.Enqueue(StringToBytes("first")));
+    EXPECT_TRUE(queue.Enqueue(StringToBytes("second")));
+    EXPECT_TRUE(readable());
+
+    EXPECT_TRUE(queue.Dequeue().has_value());
+    EXPECT_TRUE(readable());
+    EXPECT_TRUE(queue.Dequeue().has_value());
+    EXPECT_FALSE(readable());
+}
+
+// 测试延迟记录到期后数据通知句柄变为可读，不需要先调用 Dequeue/Peek
+TEST_F(PersistentQueueTest, DataAvailableFdForDelayedRecord) {
+    PersistentQueue queue(queue_name_, MakeOptions());
+    const int fd = queue.DataAvailableFd();
+    EXPECT_TRUE(queue.EnqueueAt(StringToBytes("later"),
+                                std::chrono::system_clock::now() + std::chrono::milliseconds(100)));
+
+    pollfd pfd{};
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    EXPECT_EQ(poll(&pfd, 1, 0), 0);
+    EXPECT_EQ(poll(&pfd, 1, 5000), 1);
+    EXPECT_EQ(queue.Size(), 1);
+    EXPECT_EQ(BytesToString(queue.Dequeue().value()), "later");
+}
+
+// 测试空间通知句柄在入队因空间不足失败前不可读，记录被消费后变为可读
+TEST_F(PersistentQueueTest, SpaceAvailableFd) {
+    // 多通道队列不扩展文件，每个通道占用一个 256MB 的块
+    auto options = MakeOptions();
+    options.block_size = 256 * 1024 * 1024;
+    options.priority_lanes = 2;
+    PersistentQueue queue(queue_name_, options);
+    const int fd = queue.SpaceAvailableFd();
+    EXPECT_EQ(queue.SpaceAvailableFd(), fd);
+
+    auto readable = [fd] {
+        pollfd pfd{};
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+        return poll(&pfd, 1, 0) == 1 && (pfd.revents & POLLIN) != 0;
+    };
+    const std::vector<std::byte> record(16 * 1024 * 1024);
+    size_t enqueued = 0;
+    while (queue.Enqueue(record)) {
+        ASSERT_LT(++enqueued, 64u);
+    }
+    EXPECT_GT(enqueued, 0u);
+    EXPECT_FALSE(readable());
+
+    EXPECT_TRUE(queue.Dequeue().has_value());
+    EXPECT_TRUE(readable());
+    eventfd_t value;
+    EXPECT_EQ(eventfd_read(fd, &value), 0);
+    EXPECT_FALSE(readable());
+    EXPECT_TRUE(queue.Enqueue(record));
+}
+#endif
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -0,0 +1,129 @@
+#include "persistent_file_queue/queue_manager.h"
+#include "test_fixture.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+#include <spdlog/spdlog.h>
+
+namespace fs = std::filesystem;
+using namespace persistent_file_queue;
+using persistent_file_queue::test::ToBytes;
+using persistent_file_queue::test::ToString;
+
+namespace {
+
+class QueueManagerTest : public test::QueueTest {
+protected:
+    QueueManagerTest() : QueueTest("", "test_manager_storage", "test_manager_logs") {}
+
+    // 使用测试目录的管理器配置，维护线程间隔足够长，由测试显式触发维护
+    QueueManagerOptions MakeOptions() const {
+        QueueManagerOptions options;
+        options.queue_options = QueueTest::MakeOptions();
+        options.maintenance_interval = std::chrono::hours(1);
+        options.idle_timeout = std::chrono::milliseconds(0);
+        options.preallocate = false;
+        options.compact = false;
+        return options;
+    }
+};
+
+} // namespace
+
+// 测试队列在首次访问时打开，空闲超时后关闭，重新访问时恢复数据
+TEST_F(QueueManagerTest, LazyOpenAndIdleClose) {
+    QueueManagerOptions options = MakeOptions();
+    options.idle_timeout = std::chrono::milliseconds(1);
+    QueueManager manager(options);
+    EXPECT_EQ(manager.OpenCount(), 0);
+
+    {
+        auto queue = manager.Get("orders");
+        EXPECT_EQ(manager.Get("orders"), queue);
+        EXPECT_TRUE(queue->Enqueue(ToBytes("order-1")));
+        EXPECT_EQ(manager.OpenCount(), 1);
+
+        // 持有句柄期间不会被关闭
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        manager.RunMaintenance();
+        EXPECT_EQ(manager.OpenCount(), 1);
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    manager.RunMaintenance();
+    EXPECT_EQ(manager.OpenCount(), 0);
+    EXPECT_EQ(manager.MappedBytes(), 0);
+
+    auto queue = manager.Get("orders");
+    auto result = queue->Dequeue();
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(ToString(result.value()), "order-1");
+}
+
+// 测试超出映射预算时按最久未访问的顺序关闭空闲队列
+TEST_F(QueueManagerTest, MappedBytesBudget) {
+    QueueManagerOptions options = MakeOptions();
+    {
+        QueueManager probe(options);
+        EXPECT_TRUE(probe.Get("probe")->Enqueue(ToBytes("x")));
+        options.mapped_bytes_budget = probe.MappedBytes() * 2;
+    }
+    QueueManager manager(options);
+
+    auto pinned = manager.Get("q0");
+    EXPECT_TRUE(pinned->Enqueue(ToBytes("pinned")));
+    for (const std::string name : {"q1", "q2", "q3"}) {
+        EXPECT_TRUE(manager.Get(name)->Enqueue(ToBytes(name)));
+    }
+    EXPECT_EQ(manager.OpenCount(), 4);
+
+    manager.RunMaintenance();
+    EXPECT_LE(manager.MappedBytes(), options.mapped_bytes_budget);
+    EXPECT_EQ(manager.OpenCount(), 2);
+
+    // 正在使用的 q0 和最近访问的 q3 保持打开，被关闭的队列重新打开后数据仍在
+    EXPECT_EQ(pinned->Size(), 1);
+    auto result = manager.Get("q1")->Dequeue();
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(ToString(result.value()), "q1");
+}
+
+// 测试后台预分配提前映射下一个写入块
+TEST_F(QueueManagerTest, PreallocateNextBlock) {
+    QueueManagerOptions options = MakeOptions();
+    options.preallocate = true;
+    QueueManager manager(options);
+
+    auto queue = manager.Get("growing");
+    EXPECT_TRUE(queue->Enqueue(ToBytes("first")));
+    const size_t mapped = queue->MappedBytes();
+    manager.RunMaintenance();
+    EXPECT_EQ(queue->MappedBytes(), mapped + options.queue_options.block_size);
+    EXPECT_FALSE(queue->Preallocate());
+
+    // 写入跨入预分配的块后仍可正常读取
+    const std::vector<std::byte> record(options.queue_options.block_size / 2);
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_TRUE(queue->Enqueue(record));
+    }
+    EXPECT_EQ(queue->Size(), 4);
+    EXPECT_EQ(ToString(queue->Dequeue().value()), "first");
+}
+
+// 测试关闭一个队列不影响其他队列共享的日志记录器
+TEST_F(QueueManagerTest, ClosingQueueKeepsSharedLogger) {
+    QueueManagerOptions options = MakeOptions();
+    options.idle_timeout = std::chrono::milliseconds(1);
+    QueueManager manager(options);
+
+    auto kept = manager.Get("kept");
+    manager.Get("closed");
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    manager.RunMaintenance();
+    EXPECT_EQ(manager.OpenCount(), 1);
+    EXPECT_NE(spdlog::get("persistent_queue"), nullptr);
+    EXPECT_TRUE(kept->Enqueue(ToBytes("still logging")));
+}
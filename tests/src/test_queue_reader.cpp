@@ -0,0 +1,179 @@
+#include "persistent_file_queue/queue_reader.h"
+#include "persistent_file_queue/queue_upgrade.h"
+#include "test_fixture.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+using namespace persistent_file_queue;
+using persistent_file_queue::test::ToBytes;
+using persistent_file_queue::test::ToString;
+
+namespace {
+
+class QueueReaderTest : public test::QueueTest {
+protected:
+    QueueReaderTest() : QueueTest("reader_queue", "test_reader_storage", "test_reader_logs") {}
+};
+
+} // namespace
+
+// 测试读取器遍历记录但不消费
+TEST_F(QueueReaderTest, ReadsWithoutConsuming) {
+    PersistentQueue queue(queue_name_, MakeOptions());
+    for (const std::string item : {"a", "bb", "ccc"}) {
+        EXPECT_TRUE(queue.Enqueue(ToBytes(item)));
+    }
+
+    QueueReader reader(queue_name_, MakeOptions());
+    for (const std::string expected : {"a", "bb", "ccc"}) {
+        auto record = reader.Next();
+        ASSERT_TRUE(record.has_value());
+        EXPECT_EQ(ToString(*record), expected);
+    }
+    EXPECT_FALSE(reader.Next().has_value());
+    EXPECT_EQ(queue.Size(), 3);
+
+    // 重新从读取位置开始遍历
+    reader.SeekToHead();
+    auto record = reader.Next();
+    ASSERT_TRUE(record.has_value());
+    EXPECT_EQ(ToString(*record), "a");
+}
+
+// 测试跟随写入方读取新提交的记录
+TEST_F(QueueReaderTest, TailsNewRecords) {
+    PersistentQueue queue(queue_name_, MakeOptions());
+    QueueReader reader(queue_name_, MakeOptions());
+    EXPECT_FALSE(reader.Next().has_value());
+
+    std::thread producer([&queue] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        EXPECT_TRUE(queue.Enqueue(ToBytes("tail")));
+    });
+    auto record = reader.WaitNext(std::chrono::seconds(5));
+    producer.join();
+    ASSERT_TRUE(record.has_value());
+    EXPECT_EQ(ToString(*record), "tail");
+    EXPECT_FALSE(reader.WaitNext(std::chrono::milliseconds(10)).has_value());
+}
+
+// 测试队列非空时（没有空与非空的切换）等待中的读取器也能被新提交的记录及时唤醒
+TEST_F(QueueReaderTest, WakesOnCommitToNonEmptyQueue) {
+    PersistentQueue queue(queue_name_, MakeOptions());
+    EXPECT_TRUE(queue.Enqueue(ToBytes("backlog")));
+    QueueReader reader(queue_name_, MakeOptions());
+    ASSERT_TRUE(reader.Next().has_value());
+
+    std::thread producer([&queue] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        EXPECT_TRUE(queue.Enqueue(ToBytes("next")));
+    });
+    const auto start = std::chrono::steady_clock::now();
+    auto record = reader.WaitNext(std::chrono::seconds(5));
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    producer.join();
+    ASSERT_TRUE(record.has_value());
+    EXPECT_EQ(ToString(*record), "next");
+    EXPECT_LT(elapsed, std::chrono::milliseconds(90));  // 早于读取器的分段等待超时
+}
+
+// 测试消费者越过游标后，读取器跳到新的读取位置
+TEST_F(QueueReaderTest, SkipsConsumedRecords) {
+    PersistentQueue queue(queue_name_, MakeOptions());
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_TRUE(queue.Enqueue(ToBytes("item" + std::to_string(i))));
+    }
+    QueueReader reader(queue_name_, MakeOptions());
+    ASSERT_TRUE(reader.Next().has_value());
+
+    EXPECT_TRUE(queue.Dequeue().has_value());
+    EXPECT_TRUE(queue.Dequeue().has_value());
+    EXPECT_TRUE(queue.Dequeue().has_value());
+    EXPECT_FALSE(reader.Next().has_value());
+
+    EXPECT_TRUE(queue.Enqueue(ToBytes("fresh")));
+    auto record = reader.Next();
+    ASSERT_TRUE(record.has_value());
+    EXPECT_EQ(ToString(*record), "fresh");
+}
+
+// 测试记录长度字段损坏时报告数据损坏，而不是当作已读到队列末尾
+TEST_F(QueueReaderTest, CorruptedLengthThrows) {
+    size_t second_offset = 0;
+    {
+        PersistentQueue queue(queue_name_, MakeOptions());
+        EXPECT_TRUE(queue.Enqueue(ToBytes("first")));
+        second_offset = MakeOptions().block_size + queue.TotalBytes();
+        EXPECT_TRUE(queue.Enqueue(ToBytes("second")));
+        EXPECT_TRUE(queue.Enqueue(ToBytes("third")));
+    }
+    {
+        std::fstream file(fs::path(storage_dir_) / (queue_name_ + ".dat"),
+                          std::ios::in | std::ios::out | std::ios::binary);
+        const uint32_t bad_size = 0x00FFFFFF;
+        file.seekp(static_cast<std::streamoff>(second_offset));
+        file.write(reinterpret_cast<const char*>(&bad_size), sizeof(bad_size));
+    }
+
+    QueueReader reader(queue_name_, MakeOptions());
+    auto record = reader.Next();
+    ASSERT_TRUE(record.has_value());
+    EXPECT_EQ(ToString(*record), "first");
+    EXPECT_THROW(reader.Next(), std::runtime_error);
+}
+
+// 测试读取器打开期间写入方不收缩文件，读取器关闭后恢复收缩
+TEST_F(QueueReaderTest, CompactWaitsForReaders) {
+    const fs::path file_path = fs::path(storage_dir_) / (queue_name_ + ".dat");
+    PersistentQueue queue(queue_name_, MakeOptions());
+    const std::vector<std::byte> large(MakeOptions().block_size, std::byte{'l'});
+    for (int i = 0; i < 8; ++i) {
+        EXPECT_TRUE(queue.Enqueue(large));
+    }
+    const size_t grown_size = fs::file_size(file_path);
+    {
+        QueueReader reader(queue_name_, MakeOptions());
+        ASSERT_TRUE(reader.Next().has_value());
+        while (queue.Dequeue()) {
+        }
+        EXPECT_EQ(queue.Compact(), 0);
+        EXPECT_EQ(fs::file_size(file_path), grown_size);
+        EXPECT_FALSE(reader.Next().has_value());
+    }
+    EXPECT_GT(queue.Compact(), 0);
+    EXPECT_LT(fs::file_size(file_path), grown_size);
+}
+
+// 测试读取器打开期间不按记录大小分布调整块大小
+TEST_F(QueueReaderTest, AdaptiveBlockSizeWaitsForReaders) {
+    QueueOptions options = MakeOptions();
+    options.block_size = PersistentQueue::DEFAULT_BLOCK_SIZE;
+    options.adaptive_block_size = true;
+    PersistentQueue queue(queue_name_, options);
+    auto txn = queue.BeginTxn();
+    for (int i = 0; i < 2000; ++i) {
+        txn.Append(std::vector<std::byte>(64, std::byte{'e'}));
+    }
+    EXPECT_TRUE(queue.CommitTxn(txn));
+    {
+        QueueReader reader(queue_name_, options);
+        ASSERT_TRUE(reader.Next().has_value());
+        EXPECT_EQ(queue.ForEach(2000, [](const RecordView&) { return true; }), 2000);
+        queue.Compact();
+        EXPECT_EQ(QueueBlockSize(queue_name_, options), PersistentQueue::DEFAULT_BLOCK_SIZE);
+        EXPECT_FALSE(reader.Next().has_value());
+    }
+    queue.Compact();
+    EXPECT_EQ(QueueBlockSize(queue_name_, options), 64 * 1024);
+}
+
+// 测试队列文件不存在时无法打开
+TEST_F(QueueReaderTest, MissingQueueThrows) {
+    EXPECT_THROW(QueueReader(queue_name_, MakeOptions()), std::runtime_error);
+}
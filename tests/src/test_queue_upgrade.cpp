@@ -0,0 +1,140 @@
+#include "persistent_file_queue/queue_upgrade.h"
+#include "test_fixture.h"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+using namespace persistent_file_queue;
+using persistent_file_queue::test::ToBytes;
+using persistent_file_queue::test::ToString;
+
+namespace {
+
+class QueueUpgradeTest : public test::QueueTest {
+protected:
+    QueueUpgradeTest() : QueueTest("upgrade_queue", "test_upgrade_storage", "test_upgrade_logs") {}
+};
+
+} // namespace
+
+// 测试新文件默认使用 v1，配置的版本只影响新建文件，不支持的版本被拒绝
+TEST_F(QueueUpgradeTest, FormatVersionSelection) {
+    QueueOptions options = MakeOptions();
+    {
+        PersistentQueue queue(queue_name_, options);
+        EXPECT_TRUE(queue.Enqueue(ToBytes("v1 record")));
+    }
+    EXPECT_EQ(QueueFormatVersion(queue_name_, options), PersistentQueue::DEFAULT_FORMAT_VERSION);
+
+    // 已有 v1 文件在配置 v2 时仍按 v1 打开，可以继续消费
+    options.format_version = PersistentQueue::LATEST_FORMAT_VERSION;
+    {
+        PersistentQueue queue(queue_name_, options);
+        EXPECT_EQ(ToString(queue.Dequeue().value()), "v1 record");
+    }
+    EXPECT_EQ(QueueFormatVersion(queue_name_, options), PersistentQueue::DEFAULT_FORMAT_VERSION);
+
+    QueueOptions v2_options = MakeOptions();
+    v2_options.format_version = PersistentQueue::LATEST_FORMAT_VERSION;
+    PersistentQueue v2_queue("v2_queue", v2_options);
+    EXPECT_EQ(QueueFormatVersion("v2_queue", v2_options), PersistentQueue::LATEST_FORMAT_VERSION);
+
+    options.format_version = 99;
+    EXPECT_THROW(PersistentQueue("unsupported", options), std::invalid_argument);
+}
+
+// 测试升级：各通道未消费的记录和幂等生产者状态迁移到新格式，已消费的记录不迁移
+TEST_F(QueueUpgradeTest, UpgradeV1ToV2) {
+    QueueOptions options = MakeOptions();
+    options.priority_lanes = 2;
+    {
+        PersistentQueue queue(queue_name_, options);
+        for (int i = 0; i < 100; ++i) {
+            EXPECT_TRUE(queue.Enqueue(ToBytes("low-" + std::to_string(i)), 0));
+        }
+        EXPECT_TRUE(queue.Enqueue(std::vector<std::byte>(100000, std::byte{'x'}), 0));
+        EXPECT_EQ(queue.EnqueueIdempotent(7, 3, ToBytes("high"), 1), EnqueueStatus::kEnqueued);
+        EXPECT_EQ(ToString(queue.Dequeue().value()), "high");
+        for (int i = 0; i < 10; ++i) {
+            EXPECT_EQ(ToString(queue.Dequeue().value()), "low-" + std::to_string(i));
+        }
+    }
+
+    EXPECT_EQ(UpgradeQueue(queue_name_, options, PersistentQueue::LATEST_FORMAT_VERSION), 91);
+    EXPECT_EQ(QueueFormatVersion(queue_name_, options), PersistentQueue::LATEST_FORMAT_VERSION);
+    EXPECT_FALSE(fs::exists(fs::path(storage_dir_) / (queue_name_ + ".upgrade.dat")));
+    EXPECT_EQ(UpgradeQueue(queue_name_, options, PersistentQueue::LATEST_FORMAT_VERSION), 0);
+
+    PersistentQueue queue(queue_name_, options);
+    EXPECT_EQ(queue.Size(), 91);
+    EXPECT_EQ(queue.LastSequence(7), 3);
+    EXPECT_EQ(queue.EnqueueIdempotent(7, 3, ToBytes("high"), 1), EnqueueStatus::kDuplicate);
+    for (int i = 10; i < 100; ++i) {
+        EXPECT_EQ(ToString(queue.Dequeue().value()), "low-" + std::to_string(i));
+    }
+    EXPECT_EQ(queue.Dequeue().value(), std::vector<std::byte>(100000, std::byte{'x'}));
+    EXPECT_TRUE(queue.Empty());
+}
+
+// 测试原文件有损坏记录时升级失败，原文件保持不变
+TEST_F(QueueUpgradeTest, UpgradeKeepsCorruptedQueue) {
+    QueueOptions options = MakeOptions();
+    size_t second_offset = 0;
+    {
+        PersistentQueue queue(queue_name_, options);
+        EXPECT_TRUE(queue.Enqueue(ToBytes("first")));
+        second_offset = options.block_size + queue.TotalBytes();
+        EXPECT_TRUE(queue.Enqueue(ToBytes("second")));
+        EXPECT_TRUE(queue.Enqueue(ToBytes("third")));
+    }
+    const fs::path path = fs::path(storage_dir_) / (queue_name_ + ".dat");
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        const uint32_t bad_size = 0x00FFFFFF;
+        file.seekp(static_cast<std::streamoff>(second_offset));
+        file.write(reinterpret_cast<const char*>(&bad_size), sizeof(bad_size));
+    }
+    auto read_file = [&path] {
+        std::ifstream file(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    };
+    const std::string original = read_file();
+
+    EXPECT_THROW(UpgradeQueue(queue_name_, options, PersistentQueue::LATEST_FORMAT_VERSION), std::runtime_error);
+    EXPECT_EQ(QueueFormatVersion(queue_name_, options), PersistentQueue::DEFAULT_FORMAT_VERSION);
+    EXPECT_EQ(read_file(), original);
+    EXPECT_FALSE(fs::exists(fs::path(storage_dir_) / (queue_name_ + ".upgrade.dat")));
+}
+
+// 测试按新块大小重写队列：记录和格式版本保留，非法或相同的块大小不做修改
+TEST_F(QueueUpgradeTest, ReblockQueue) {
+    QueueOptions options = MakeOptions();
+    options.priority_lanes = 2;
+    {
+        PersistentQueue queue(queue_name_, options);
+        for (int i = 0; i < 50; ++i) {
+            EXPECT_TRUE(queue.Enqueue(ToBytes("low-" + std::to_string(i)), 0));
+        }
+        EXPECT_TRUE(queue.Enqueue(std::vector<std::byte>(100000, std::byte{'x'}), 1));
+        EXPECT_EQ(ToString(queue.Dequeue().value()).size(), 100000);
+        EXPECT_EQ(ToString(queue.Dequeue().value()), "low-0");
+    }
+
+    EXPECT_THROW(ReblockQueue(queue_name_, options, 1000), std::invalid_argument);
+    EXPECT_EQ(ReblockQueue(queue_name_, options, 64 * 1024), 0);
+    EXPECT_EQ(ReblockQueue(queue_name_, options, 256 * 1024), 49);
+    EXPECT_EQ(QueueBlockSize(queue_name_, options), 256 * 1024);
+    EXPECT_EQ(QueueFormatVersion(queue_name_, options), PersistentQueue::DEFAULT_FORMAT_VERSION);
+    EXPECT_FALSE(fs::exists(fs::path(storage_dir_) / (queue_name_ + ".upgrade.dat")));
+
+    PersistentQueue queue(queue_name_, options);
+    EXPECT_EQ(queue.Size(), 49);
+    for (int i = 1; i < 50; ++i) {
+        EXPECT_EQ(ToString(queue.Dequeue().value()), "low-" + std::to_string(i));
+    }
+    EXPECT_TRUE(queue.Empty());
+}
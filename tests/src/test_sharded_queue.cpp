@@ -0,0 +1,148 @@
+#include "persistent_file_queue/sharded_queue.h"
+#include "test_fixture.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <filesystem>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+using namespace persistent_file_queue;
+using persistent_file_queue::test::ToBytes;
+using persistent_file_queue::test::ToString;
+
+namespace {
+
+class ShardedPersistentQueueTest : public test::QueueTest {
+protected:
+    ShardedPersistentQueueTest() : QueueTest("sharded_queue", "test_sharded_storage", "test_sharded_logs") {}
+
+    // 使用测试目录的队列配置
+    QueueOptions MakeOptions() const {
+        QueueOptions options = QueueTest::MakeOptions();
+        options.block_size = 64 * 1024 * 1024;
+        return options;
+    }
+};
+
+} // namespace
+
+// 测试轮询写入分散到各分片，按分片出队
+TEST_F(ShardedPersistentQueueTest, RoundRobinAcrossShards) {
+    ShardedPersistentQueue queue(queue_name_, 4, MakeOptions());
+    EXPECT_EQ(queue.ShardCount(), 4);
+    EXPECT_TRUE(queue.Empty());
+
+    for (int i = 0; i < 8; ++i) {
+        EXPECT_TRUE(queue.Enqueue(ToBytes("item" + std::to_string(i))));
+    }
+    EXPECT_EQ(queue.Size(), 8);
+
+    std::multiset<std::string> received;
+    for (size_t shard = 0; shard < queue.ShardCount(); ++shard) {
+        size_t shard_items = 0;
+        while (auto record = queue.DequeueShard(shard)) {
+            received.insert(ToString(*record));
+            shard_items++;
+        }
+        EXPECT_EQ(shard_items, 2);
+    }
+    EXPECT_EQ(received.size(), 8);
+    EXPECT_TRUE(queue.Empty());
+}
+
+// 测试相同键的记录写入同一分片并保持顺序
+TEST_F(ShardedPersistentQueueTest, KeyedEnqueueKeepsOrder) {
+    ShardedPersistentQueue queue(queue_name_, 4, MakeOptions());
+    for (int i = 0; i < 5; ++i) {
+        EXPECT_TRUE(queue.Enqueue("user-42", ToBytes(std::to_string(i))));
+    }
+
+    size_t non_empty_shards = 0;
+    for (size_t shard = 0; shard < queue.ShardCount(); ++shard) {
+        int expected = 0;
+        bool has_records = false;
+        while (auto record = queue.DequeueShard(shard)) {
+            EXPECT_EQ(ToString(*record), std::to_string(expected++));
+            has_records = true;
+        }
+        non_empty_shards += has_records ? 1 : 0;
+    }
+    EXPECT_EQ(non_empty_shards, 1);
+}
+
+// 测试按序列号归并读取
+TEST_F(ShardedPersistentQueueTest, OrderedMergeReader) {
+    ShardedPersistentQueue queue(queue_name_, 3, MakeOptions());
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_TRUE(queue.Enqueue("key" + std::to_string(i % 4), ToBytes(std::to_string(i))));
+    }
+    for (int i = 0; i < 10; ++i) {
+        auto record = queue.DequeueOrdered();
+        ASSERT_TRUE(record.has_value());
+        EXPECT_EQ(ToString(*record), std::to_string(i));
+    }
+    EXPECT_FALSE(queue.DequeueOrdered().has_value());
+}
+
+// 测试重新打开时保留数据，分片数不一致时拒绝打开
+TEST_F(ShardedPersistentQueueTest, ReopenChecksShardCount) {
+    {
+        ShardedPersistentQueue queue(queue_name_, 2, MakeOptions());
+        EXPECT_TRUE(queue.Enqueue(ToBytes("persisted")));
+    }
+    EXPECT_THROW(ShardedPersistentQueue(queue_name_, 3, MakeOptions()), std::runtime_error);
+
+    ShardedPersistentQueue queue(queue_name_, 2, MakeOptions());
+    auto record = queue.DequeueOrdered();
+    ASSERT_TRUE(record.has_value());
+    EXPECT_EQ(ToString(*record), "persisted");
+}
+
+// 测试分片中短于序列号的记录被报告为数据损坏，而不是越界读取
+TEST_F(ShardedPersistentQueueTest, ShortRecordIsCorruption) {
+    {
+        PersistentQueue shard(queue_name_ + "_shard0", MakeOptions());
+        EXPECT_TRUE(shard.Enqueue(ToBytes("abc")));
+        EXPECT_TRUE(shard.Enqueue(ToBytes("def")));
+    }
+    ShardedPersistentQueue queue(queue_name_, 1, MakeOptions());
+    EXPECT_THROW(queue.DequeueOrdered(), std::runtime_error);
+    EXPECT_THROW(queue.DequeueShard(0), std::runtime_error);
+}
+
+// 测试多生产者、多消费者并行读写
+TEST_F(ShardedPersistentQueueTest, ParallelProducersAndConsumers) {
+    const size_t shard_count = 4;
+    const int items_per_producer = 200;
+    ShardedPersistentQueue queue(queue_name_, shard_count, MakeOptions());
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < 4; ++p) {
+        producers.emplace_back([&queue, p] {
+            for (int i = 0; i < items_per_producer; ++i) {
+                EXPECT_TRUE(queue.Enqueue(ToBytes(std::to_string(p) + ":" + std::to_string(i))));
+            }
+        });
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+
+    std::atomic<size_t> consumed{0};
+    std::vector<std::thread> consumers;
+    for (size_t shard = 0; shard < shard_count; ++shard) {
+        consumers.emplace_back([&queue, &consumed, shard] {
+            while (queue.DequeueShard(shard)) {
+                consumed++;
+            }
+        });
+    }
+    for (auto& consumer : consumers) {
+        consumer.join();
+    }
+    EXPECT_EQ(consumed.load(), 4 * items_per_producer);
+    EXPECT_TRUE(queue.Empty());
+}
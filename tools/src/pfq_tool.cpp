@@ -0,0 +1,500 @@
+// pfq-tool：队列文件命令行工具，查看、校验、导出和导入队列中的记录
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <spdlog/spdlog.h>
+
+#include "persistent_file_queue/persistent_queue.h"
+#include "persistent_file_queue/queue_reader.h"
+#include "persistent_file_queue/queue_upgrade.h"
+
+namespace fs = std::filesystem;
+using namespace persistent_file_queue;
+
+namespace {
+
+constexpr const char* USAGE = R"(usage: pfq-tool <command> <storage_dir> <queue_name> [options]
+
+commands:
+  dump     print pending records without consuming them
+  stats    print record count and size distribution per priority lane
+  verify   verify checksums of all pending records
+  export   write pending records to a stream
+  import   append records from a stream
+  upgrade  convert the queue file to another record format version
+  reblock  rewrite the queue file with the block size given by --block-size
+
+options:
+  --block-size N    block size for queues created by import and target of reblock (default 67108864);
+                    existing queues are always opened with the block size stored in the file
+  --stripe-dir DIR  stripe directory, repeated in the order used when the queue was created
+  --log-dir DIR     queue log directory (default <temp>/pfq-tool-logs)
+  --format F        export/import stream format: lines (newline-delimited, default)
+                    or length (little-endian uint32 length prefix followed by the payload);
+                    export fails on records containing a newline unless --format length is used
+  --output FILE     export destination (default stdout)
+  --input FILE      import source (default stdin)
+  --consume         export: dequeue the exported records instead of reading them read-only
+  --limit N         dump/export: stop after N records
+  --priority P      import: priority lane to append to (default 0)
+  --batch N         export --consume/import: records per committed batch (default 4096)
+  --to V            upgrade: target format version (default latest)
+
+import, upgrade, reblock and export --consume open the queue for writing and must not run while another
+process has it open; dump, stats, verify and export only read the queue files.
+)";
+
+constexpr size_t IO_BUFFER_SIZE = 1024 * 1024;  // 流读写缓冲区大小
+constexpr size_t PREVIEW_SIZE = 64;             // dump 显示的数据前缀长度
+
+enum class StreamFormat {
+    kLines,   // 每条记录一行，记录中不能包含换行符
+    kLength,  // 小端 uint32 长度 + 数据
+};
+
+struct ToolOptions {
+    std::string command;
+    std::string queue_name;
+    QueueOptions queue_options;
+    StreamFormat format = StreamFormat::kLines;
+    std::string output;
+    std::string input;
+    bool consume = false;
+    size_t limit = std::numeric_limits<size_t>::max();
+    size_t priority = 0;
+    size_t batch = 4096;
+    uint64_t target_version = PersistentQueue::LATEST_FORMAT_VERSION;
+};
+
+// 命令行参数错误，打印用法后以状态码 2 退出
+class UsageError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+size_t ParseSize(const std::string& value) {
+    size_t parsed = 0;
+    unsigned long long result = 0;
+    try {
+        result = std::stoull(value, &parsed);
+    } catch (const std::exception&) {
+        parsed = 0;
+    }
+    if (parsed == 0 || parsed != value.size()) {
+        throw UsageError("Invalid number: " + value);
+    }
+    return static_cast<size_t>(result);
+}
+
+ToolOptions ParseArgs(int argc, char** argv) {
+    if (argc < 4) {
+        throw UsageError("Missing arguments");
+    }
+    ToolOptions options;
+    options.command = argv[1];
+    options.queue_options.storage_dir = argv[2];
+    options.queue_name = argv[3];
+    options.queue_options.log_dir = (fs::temp_directory_path() / "pfq-tool-logs").string();
+    for (int i = 4; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                throw UsageError("Missing value for " + arg);
+            }
+            return argv[++i];
+        };
+        if (arg == "--block-size") {
+            options.queue_options.block_size = ParseSize(value());
+        } else if (arg == "--stripe-dir") {
+            options.queue_options.stripe_dirs.push_back(value());
+        } else if (arg == "--log-dir") {
+            options.queue_options.log_dir = value();
+        } else if (arg == "--format") {
+            const std::string format = value();
+            if (format == "lines") {
+                options.format = StreamFormat::kLines;
+            } else if (format == "length") {
+                options.format = StreamFormat::kLength;
+            } else {
+                throw UsageError("Unknown format: " + format);
+            }
+        } else if (arg == "--output") {
+            options.output = value();
+        } else if (arg == "--input") {
+            options.input = value();
+        } else if (arg == "--consume") {
+            options.consume = true;
+        } else if (arg == "--limit") {
+            options.limit = ParseSize(value());
+        } else if (arg == "--priority") {
+            options.priority = ParseSize(value());
+        } else if (arg == "--to") {
+            options.target_version = ParseSize(value());
+        } else if (arg == "--batch") {
+            options.batch = std::max<size_t>(ParseSize(value()), 1);
+        } else {
+            throw UsageError("Unknown option: " + arg);
+        }
+    }
+    return options;
+}
+
+bool QueueExists(const ToolOptions& options) {
+    return fs::exists(fs::path(options.queue_options.storage_dir) / (options.queue_name + ".dat"));
+}
+
+void RequireQueue(const ToolOptions& options) {
+    if (!QueueExists(options)) {
+        throw std::runtime_error("Queue file not found: " +
+                                 (fs::path(options.queue_options.storage_dir) / (options.queue_name + ".dat")).string());
+    }
+}
+
+// 打开队列用于写入；已有队列的通道数从文件头部读取，工具不逐条记录调试日志
+std::unique_ptr<PersistentQueue> OpenQueue(const ToolOptions& options) {
+    QueueOptions queue_options = options.queue_options;
+    if (QueueExists(options)) {
+        queue_options.priority_lanes = QueueReader(options.queue_name, options.queue_options).LaneCount();
+    }
+    auto queue = std::make_unique<PersistentQueue>(options.queue_name, queue_options);
+    if (auto logger = spdlog::get("persistent_queue")) {
+        logger->set_level(spdlog::level::warn);
+    }
+    return queue;
+}
+
+// 以只读读取器按出队的通道顺序（高优先级在前）遍历未消费的记录，visitor 返回 false 时停止
+template <typename Visitor>
+void ReadRecords(const ToolOptions& options, Visitor&& visitor) {
+    RequireQueue(options);
+    const size_t lane_count = QueueReader(options.queue_name, options.queue_options).LaneCount();
+    for (size_t lane = lane_count; lane-- > 0;) {
+        QueueReader reader(options.queue_name, options.queue_options, lane);
+        while (auto record = reader.Next()) {
+            if (!visitor(lane, *record)) {
+                return;
+            }
+        }
+    }
+}
+
+// 带缓冲的输出文件，空路径表示标准输出
+class Output {
+public:
+    explicit Output(const std::string& path) : file_(path.empty() ? stdout : std::fopen(path.c_str(), "wb")) {
+        if (file_ == nullptr) {
+            throw std::runtime_error("Failed to open output file: " + path);
+        }
+        std::setvbuf(file_, nullptr, _IOFBF, IO_BUFFER_SIZE);
+    }
+
+    ~Output() {
+        if (file_ != stdout) {
+            std::fclose(file_);
+        }
+    }
+
+    Output(const Output&) = delete;
+    Output& operator=(const Output&) = delete;
+
+    void Write(const void* data, size_t size) {
+        if (std::fwrite(data, 1, size, file_) != size) {
+            throw std::runtime_error("Failed to write output");
+        }
+    }
+
+    void WriteRecord(StreamFormat format, const RecordView& record) {
+        if (format == StreamFormat::kLength) {
+            const auto size = static_cast<uint32_t>(record.size);
+            const unsigned char prefix[4] = {static_cast<unsigned char>(size), static_cast<unsigned char>(size >> 8),
+                                             static_cast<unsigned char>(size >> 16),
+                                             static_cast<unsigned char>(size >> 24)};
+            Write(prefix, sizeof(prefix));
+            Write(record.data, record.size);
+        } else {
+            // 换行符会把一条记录拆成多条，导入时无法还原
+            if (std::memchr(record.data, '\n', record.size) != nullptr) {
+                throw std::runtime_error("Record contains a newline and cannot be written as lines; use --format length");
+            }
+            Write(record.data, record.size);
+            Write("\n", 1);
+        }
+    }
+
+    void Flush() {
+        if (std::fflush(file_) != 0) {
+            throw std::runtime_error("Failed to write output");
+        }
+    }
+
+private:
+    std::FILE* file_;
+};
+
+// 带缓冲的输入流，按格式切分记录，空路径表示标准输入
+class Input {
+public:
+    explicit Input(const std::string& path) : file_(path.empty() ? stdin : std::fopen(path.c_str(), "rb")) {
+        if (file_ == nullptr) {
+            throw std::runtime_error("Failed to open input file: " + path);
+        }
+        buffer_.resize(IO_BUFFER_SIZE);
+    }
+
+    ~Input() {
+        if (file_ != stdin) {
+            std::fclose(file_);
+        }
+    }
+
+    Input(const Input&) = delete;
+    Input& operator=(const Input&) = delete;
+
+    // 读取下一条记录到 record，输入结束时返回 false
+    bool Next(StreamFormat format, std::vector<std::byte>& record) {
+        record.clear();
+        if (format == StreamFormat::kLines) {
+            while (true) {
+                if (begin_ == end_ && !Fill()) {
+                    // 最后一行没有换行符时同样作为一条记录
+                    return !record.empty();
+                }
+                const auto* start = buffer_.data() + begin_;
+                const auto* newline = static_cast<const std::byte*>(std::memchr(start, '\n', end_ - begin_));
+                const size_t length = newline == nullptr ? end_ - begin_ : static_cast<size_t>(newline - start);
+                record.insert(record.end(), start, start + length);
+                begin_ += length;
+                if (newline != nullptr) {
+                    begin_++;
+                    return true;
+                }
+            }
+        }
+
+        std::byte prefix[4];
+        const size_t read = Read(prefix, sizeof(prefix));
+        if (read == 0) {
+            return false;
+        }
+        if (read != sizeof(prefix)) {
+            throw std::runtime_error("Truncated length prefix in input");
+        }
+        const uint32_t size = std::to_integer<uint32_t>(prefix[0]) | std::to_integer<uint32_t>(prefix[1]) << 8 |
+                              std::to_integer<uint32_t>(prefix[2]) << 16 | std::to_integer<uint32_t>(prefix[3]) << 24;
+        record.resize(size);
+        if (Read(record.data(), size) != size) {
+            throw std::runtime_error("Truncated record in input");
+        }
+        return true;
+    }
+
+private:
+    bool Fill() {
+        begin_ = 0;
+        end_ = std::fread(buffer_.data(), 1, buffer_.size(), file_);
+        if (end_ == 0 && std::ferror(file_)) {
+            throw std::runtime_error("Failed to read input");
+        }
+        return end_ > 0;
+    }
+
+    size_t Read(std::byte* data, size_t size) {
+        size_t copied = 0;
+        while (copied < size) {
+            if (begin_ == end_ && !Fill()) {
+                break;
+            }
+            const size_t chunk = std::min(size - copied, end_ - begin_);
+            std::memcpy(data + copied, buffer_.data() + begin_, chunk);
+            begin_ += chunk;
+            copied += chunk;
+        }
+        return copied;
+    }
+
+    std::FILE* file_;
+    std::vector<std::byte> buffer_;
+    size_t begin_ = 0;
+    size_t end_ = 0;
+};
+
+int Dump(const ToolOptions& options) {
+    size_t index = 0;
+    ReadRecords(options, [&](size_t lane, const RecordView& record) {
+        std::string preview;
+        for (size_t i = 0; i < std::min(record.size, PREVIEW_SIZE); ++i) {
+            const char c = static_cast<char>(record.data[i]);
+            preview.push_back(c >= 0x20 && c < 0x7f ? c : '.');
+        }
+        std::printf("%zu\tlane=%zu\tsize=%zu\t%s%s\n", index, lane, record.size, preview.c_str(),
+                    record.size > PREVIEW_SIZE ? "..." : "");
+        return ++index < options.limit;
+    });
+    return 0;
+}
+
+int Stats(const ToolOptions& options) {
+    struct LaneStats {
+        size_t records = 0;
+        size_t bytes = 0;
+        size_t min_size = std::numeric_limits<size_t>::max();
+        size_t max_size = 0;
+    };
+    RequireQueue(options);
+    std::vector<LaneStats> lanes(QueueReader(options.queue_name, options.queue_options).LaneCount());
+    RecordSizeStats sizes;
+    ReadRecords(options, [&](size_t lane, const RecordView& record) {
+        size_t bucket = 0;
+        while (bucket + 1 < RecordSizeStats::BUCKETS && record.size >> (bucket + 1) != 0) {
+            bucket++;
+        }
+        sizes.buckets[bucket]++;
+        LaneStats& stats = lanes[lane];
+        stats.records++;
+        stats.bytes += record.size;
+        stats.min_size = std::min(stats.min_size, record.size);
+        stats.max_size = std::max(stats.max_size, record.size);
+        return true;
+    });
+
+    LaneStats total;
+    for (size_t lane = 0; lane < lanes.size(); ++lane) {
+        const LaneStats& stats = lanes[lane];
+        std::printf("lane %zu: records=%zu bytes=%zu", lane, stats.records, stats.bytes);
+        if (stats.records > 0) {
+            std::printf(" min=%zu max=%zu avg=%zu", stats.min_size, stats.max_size, stats.bytes / stats.records);
+        }
+        std::printf("\n");
+        total.records += stats.records;
+        total.bytes += stats.bytes;
+    }
+    std::printf("total: records=%zu bytes=%zu\n", total.records, total.bytes);
+    std::printf("format: v%llu\n",
+                static_cast<unsigned long long>(QueueFormatVersion(options.queue_name, options.queue_options)));
+    std::printf("block size: %zu (recommended for pending records: %zu)\n",
+                QueueBlockSize(options.queue_name, options.queue_options), PersistentQueue::RecommendBlockSize(sizes));
+    return 0;
+}
+
+int Verify(const ToolOptions& options) {
+    // 以只读读取器逐条校验各通道中未消费的记录，发现损坏时抛出异常；
+    // 不打开写入方，避免转出到期的延迟记录或改写头部
+    size_t verified = 0;
+    ReadRecords(options, [&](size_t, const RecordView&) {
+        verified++;
+        return true;
+    });
+    std::printf("OK: %zu records verified\n", verified);
+    return 0;
+}
+
+int Export(const ToolOptions& options) {
+    Output output(options.output);
+    size_t exported = 0;
+    if (options.consume) {
+        // 批量出队：记录原地写出，每批提交一次读取位置
+        RequireQueue(options);
+        auto queue = OpenQueue(options);
+        exported = queue->ForEach(
+            options.limit,
+            [&](const RecordView& record) {
+                output.WriteRecord(options.format, record);
+                return true;
+            },
+            options.batch);
+    } else {
+        ReadRecords(options, [&](size_t, const RecordView& record) {
+            output.WriteRecord(options.format, record);
+            return ++exported < options.limit;
+        });
+    }
+    output.Flush();
+    std::fprintf(stderr, "Exported %zu records\n", exported);
+    return 0;
+}
+
+int Import(const ToolOptions& options) {
+    Input input(options.input);
+    auto queue = OpenQueue(options);
+    auto txn = queue->BeginTxn(options.priority);
+    size_t imported = 0;
+    // 每批记录通过一次事务提交，只刷新一次头部
+    auto commit = [&] {
+        const size_t pending = txn.Size();
+        if (pending > 0 && !queue->CommitTxn(txn)) {
+            throw std::runtime_error("Queue is full after importing " + std::to_string(imported) + " records");
+        }
+        imported += pending;
+    };
+    std::vector<std::byte> record;
+    while (input.Next(options.format, record)) {
+        txn.Append(record);
+        if (txn.Size() >= options.batch) {
+            commit();
+        }
+    }
+    commit();
+    std::fprintf(stderr, "Imported %zu records\n", imported);
+    return 0;
+}
+
+int Upgrade(const ToolOptions& options) {
+    RequireQueue(options);
+    const uint64_t version = QueueFormatVersion(options.queue_name, options.queue_options);
+    const size_t migrated = UpgradeQueue(options.queue_name, options.queue_options, options.target_version);
+    std::printf("format v%llu -> v%llu, %zu records migrated\n", static_cast<unsigned long long>(version),
+                static_cast<unsigned long long>(options.target_version), migrated);
+    return 0;
+}
+
+int Reblock(const ToolOptions& options) {
+    RequireQueue(options);
+    const size_t block_size = QueueBlockSize(options.queue_name, options.queue_options);
+    const size_t migrated = ReblockQueue(options.queue_name, options.queue_options, options.queue_options.block_size);
+    std::printf("block size %zu -> %zu, %zu records migrated\n", block_size, options.queue_options.block_size, migrated);
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    try {
+        const ToolOptions options = ParseArgs(argc, argv);
+        if (options.command == "dump") {
+            return Dump(options);
+        }
+        if (options.command == "stats") {
+            return Stats(options);
+        }
+        if (options.command == "verify") {
+            return Verify(options);
+        }
+        if (options.command == "export") {
+            return Export(options);
+        }
+        if (options.command == "import") {
+            return Import(options);
+        }
+        if (options.command == "upgrade") {
+            return Upgrade(options);
+        }
+        if (options.command == "reblock") {
+            return Reblock(options);
+        }
+        throw UsageError("Unknown command: " + options.command);
+    } catch (const UsageError& e) {
+        std::fprintf(stderr, "%s\n\n%s", e.what(), USAGE);
+        return 2;
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "error: %s\n", e.what());
+        return 1;
+    }
+}
@@ -0,0 +1,135 @@
+#include "persistent_file_queue/persistent_queue.h"
+#include "test_fixture.h"
+#include <gtest/gtest.h>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <sys/wait.h>
+
+namespace fs = std::filesystem;
+using namespace persistent_file_queue;
+using persistent_file_queue::test::ToBytes;
+using persistent_file_queue::test::ToString;
+
+namespace {
+
+class PfqToolTest : public test::QueueTest {
+protected:
+    PfqToolTest() : QueueTest("", "test_pfq_tool_storage", "test_pfq_tool_logs") {}
+
+    void SetUp() override {
+        QueueTest::SetUp();
+        fs::create_directories(storage_dir_);
+    }
+
+    // 对队列执行 pfq-tool 命令，返回进程退出码，标准输出和标准错误写入 output_path_
+    int Run(const std::string& command, const std::string& queue_name, const std::string& args) const {
+        const std::string line = std::string(PFQ_TOOL_PATH) + " " + command + " " + storage_dir_ + " " + queue_name +
+                                 " --block-size 65536 --log-dir " + log_dir_ + " " + args + " > " + output_path_ +
+                                 " 2>&1";
+        const int status = std::system(line.c_str());
+        return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    }
+
+    std::string ReadOutput() const {
+        std::ifstream file(output_path_, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    const std::string output_path_ = storage_dir_ + "/tool.out";
+    const std::string stream_path_ = storage_dir_ + "/records.stream";
+};
+
+// 依次出队队列中的全部记录
+std::vector<std::string> Drain(PersistentQueue& queue) {
+    std::vector<std::string> records;
+    while (auto record = queue.Dequeue()) {
+        records.push_back(ToString(*record));
+    }
+    return records;
+}
+
+} // namespace
+
+// 测试按行格式导出后再导入，记录内容和顺序不变
+TEST_F(PfqToolTest, LinesRoundTrip) {
+    const std::vector<std::string> records = {"alpha", "", "gamma delta"};
+    {
+        PersistentQueue queue("source", MakeOptions());
+        for (const auto& record : records) {
+            EXPECT_TRUE(queue.Enqueue(ToBytes(record)));
+        }
+    }
+    ASSERT_EQ(Run("export", "source", "--output " + stream_path_), 0) << ReadOutput();
+    ASSERT_EQ(Run("import", "target", "--input " + stream_path_), 0) << ReadOutput();
+
+    PersistentQueue target("target", MakeOptions());
+    EXPECT_EQ(Drain(target), records);
+    PersistentQueue source("source", MakeOptions());
+    EXPECT_EQ(source.Size(), records.size());
+}
+
+// 测试按长度前缀格式导出后再导入，包含换行符和二进制数据的记录保持不变
+TEST_F(PfqToolTest, LengthRoundTrip) {
+    const std::vector<std::string> records = {"line one\nline two", std::string("\0\n\xff", 3), ""};
+    {
+        PersistentQueue queue("source", MakeOptions());
+        for (const auto& record : records) {
+            EXPECT_TRUE(queue.Enqueue(ToBytes(record)));
+        }
+    }
+    ASSERT_EQ(Run("export", "source", "--format length --output " + stream_path_), 0) << ReadOutput();
+    ASSERT_EQ(Run("import", "target", "--format length --input " + stream_path_), 0) << ReadOutput();
+
+    PersistentQueue target("target", MakeOptions());
+    EXPECT_EQ(Drain(target), records);
+}
+
+// 测试按行格式导出包含换行符的记录时报错并提示使用长度前缀格式
+TEST_F(PfqToolTest, LinesRejectsNewline) {
+    {
+        PersistentQueue queue("source", MakeOptions());
+        EXPECT_TRUE(queue.Enqueue(ToBytes("first\nsecond")));
+    }
+    EXPECT_EQ(Run("export", "source", "--output " + stream_path_), 1);
+    EXPECT_NE(ReadOutput().find("--format length"), std::string::npos);
+
+    // 消费模式下导出失败时记录仍保留在队列中
+    EXPECT_EQ(Run("export", "source", "--consume --output " + stream_path_), 1);
+    PersistentQueue queue("source", MakeOptions());
+    EXPECT_EQ(Drain(queue), std::vector<std::string>{"first\nsecond"});
+}
+
+// 测试校验命令在记录损坏时报错，且不修改队列文件
+TEST_F(PfqToolTest, VerifyDetectsCorruption) {
+    size_t second_offset = 0;
+    {
+        PersistentQueue queue("source", MakeOptions());
+        EXPECT_TRUE(queue.Enqueue(ToBytes("intact-record")));
+        second_offset = MakeOptions().block_size + queue.TotalBytes();
+        EXPECT_TRUE(queue.Enqueue(ToBytes("corrupted-record")));
+    }
+    ASSERT_EQ(Run("verify", "source", ""), 0) << ReadOutput();
+    EXPECT_NE(ReadOutput().find("OK: 2 records verified"), std::string::npos);
+
+    // 改写第二条记录的数据，使其校验和不匹配
+    const fs::path path = fs::path(storage_dir_) / "source.dat";
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        std::string window(64, '\0');
+        file.seekg(static_cast<std::streamoff>(second_offset));
+        file.read(window.data(), static_cast<std::streamsize>(window.size()));
+        const size_t offset = window.find("corrupted-record");
+        ASSERT_NE(offset, std::string::npos);
+        file.seekp(static_cast<std::streamoff>(second_offset + offset));
+        file.put('C');
+    }
+    const auto modified = fs::last_write_time(path);
+
+    EXPECT_EQ(Run("verify", "source", ""), 1);
+    EXPECT_NE(ReadOutput().find("checksum mismatch"), std::string::npos) << ReadOutput();
+    EXPECT_EQ(fs::last_write_time(path), modified);
+}